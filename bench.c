@@ -43,15 +43,276 @@ static void load_file(const char* filename, void** buf, size_t* len) {
 static float src_pixels[NPIXELS * 4],
              dst_pixels[NPIXELS * 4];
 
+static double now_seconds(void) {
+    struct timespec ts;
+    expect(timespec_get(&ts, TIME_UTC) == TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Measure how skcms_TransformRunParallel() scales with thread count over one large image.
+static bool bench_parallel(int n, int max_threads,
+                           const skcms_ICCProfile* src_profile,
+                           const skcms_ICCProfile* dst_profile) {
+    const size_t npixels = 4096 * 4096;
+    uint8_t* src = malloc(npixels * 4);
+    uint8_t* dst = malloc(npixels * 4);
+    expect(src && dst);
+    for (size_t i = 0; i < npixels * 4; i++) {
+        src[i] = (uint8_t)(i * 37 + (i >> 12));
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    skcms_CompiledTransform* xform =
+        skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                              skcms_PixelFormat_RGBA_8888, upm, dst_profile);
+    expect(xform);
+
+    bool all_ok = true;
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) {
+            all_ok &= skcms_TransformRunParallel(xform, src, dst, npixels, threads);
+        }
+        double mpix = (double)npixels * n / (now_seconds() - start) * 1e-6;
+        if (threads == 1) {
+            base = mpix;
+        }
+        printf("%2d threads: %8.1f Mpix/s (%.2fx)\n", threads, mpix, mpix / base);
+    }
+
+    skcms_TransformDestroy(xform);
+    free(src);
+    free(dst);
+    return all_ok;
+}
+
+// Compare an exact transform against one baked into a grid of this many points per channel.
+static bool bench_baked(int n, int grid_points,
+                        const skcms_ICCProfile* src_profile,
+                        const skcms_ICCProfile* dst_profile) {
+    const size_t npixels = 1024 * 1024;
+    uint8_t* src = malloc(npixels * 4);
+    uint8_t* dst = malloc(npixels * 4);
+    expect(src && dst);
+    for (size_t i = 0; i < npixels * 4; i++) {
+        src[i] = (uint8_t)(i * 37 + (i >> 12));
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    float max_error;
+    skcms_CompiledTransform* xforms[] = {
+        skcms_TransformCreate     (skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                                   skcms_PixelFormat_RGBA_8888, upm, dst_profile),
+        skcms_TransformCreateBaked(skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                                   skcms_PixelFormat_RGBA_8888, upm, dst_profile,
+                                   grid_points, &max_error),
+    };
+    expect(xforms[0] && xforms[1]);
+
+    bool all_ok = true;
+    for (int x = 0; x < 2; x++) {
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) {
+            all_ok &= skcms_TransformRun(xforms[x], src, dst, npixels);
+        }
+        double mpix = (double)npixels * n / (now_seconds() - start) * 1e-6;
+        printf("%s: %8.1f Mpix/s\n", x ? "baked" : "exact", mpix);
+        skcms_TransformDestroy(xforms[x]);
+    }
+    printf("max error with %d^3 grid: %.3f\n", grid_points, (double)max_error);
+
+    free(src);
+    free(dst);
+    return all_ok;
+}
+
+// Compare multilinear and simplex CLUT interpolation, e.g. with an A2B source or B2A destination.
+static bool bench_interpolation(int n,
+                                const skcms_ICCProfile* src_profile,
+                                const skcms_ICCProfile* dst_profile) {
+    const size_t npixels = 1024 * 1024;
+    uint8_t* src = malloc(npixels * 4);
+    uint8_t* dst[2] = { malloc(npixels * 4), malloc(npixels * 4) };
+    expect(src && dst[0] && dst[1]);
+    for (size_t i = 0; i < npixels * 4; i++) {
+        src[i] = (uint8_t)(i * 37 + (i >> 12));
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    const char* names[] = { "multilinear", "simplex" };
+    bool all_ok = true;
+    for (int x = 0; x < 2; x++) {
+        skcms_CompiledTransform* xform = skcms_TransformCreateWithInterpolation(
+                skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                skcms_PixelFormat_RGBA_8888, upm, dst_profile,
+                x ? skcms_Interpolation_Simplex : skcms_Interpolation_Multilinear);
+        expect(xform);
+
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) {
+            all_ok &= skcms_TransformRun(xform, src, dst[x], npixels);
+        }
+        double mpix = (double)npixels * n / (now_seconds() - start) * 1e-6;
+        printf("%11s: %8.1f Mpix/s\n", names[x], mpix);
+        skcms_TransformDestroy(xform);
+    }
+
+    int worst = 0;
+    double total = 0;
+    for (size_t i = 0; i < npixels * 4; i++) {
+        int diff = abs(dst[0][i] - dst[1][i]);
+        worst  = diff > worst ? diff : worst;
+        total += diff;
+    }
+    printf("difference: max %d, mean %.4f\n", worst, total / (double)(npixels * 4));
+
+    free(src);
+    free(dst[0]);
+    free(dst[1]);
+    return all_ok;
+}
+
+// Compare each CLUT memory layout, e.g. with a CMYK source.  They should all give the same results.
+static bool bench_layout(int n,
+                         const skcms_ICCProfile* src_profile,
+                         const skcms_ICCProfile* dst_profile) {
+    const size_t npixels = 1024 * 1024;
+    uint8_t* src = malloc(npixels * 4);
+    uint8_t* dst[2] = { malloc(npixels * 4), malloc(npixels * 4) };
+    expect(src && dst[0] && dst[1]);
+    for (size_t i = 0; i < npixels * 4; i++) {
+        src[i] = (uint8_t)(i * 37 + (i >> 12));
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    const struct { skcms_CLUTLayout layout; const char* name; } layouts[] = {
+        { skcms_CLUTLayout_ICC,     "icc"     },
+        { skcms_CLUTLayout_Packed,  "packed"  },
+        { skcms_CLUTLayout_Blocked, "blocked" },
+    };
+    bool all_ok = true;
+    for (int x = 0; x < (int)(sizeof(layouts) / sizeof(*layouts)); x++) {
+        skcms_CompiledTransform* xform = skcms_TransformCreateWithCLUTLayout(
+                skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                skcms_PixelFormat_RGBA_8888, upm, dst_profile, layouts[x].layout);
+        expect(xform);
+
+        uint8_t* out = dst[x ? 1 : 0];
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) {
+            all_ok &= skcms_TransformRun(xform, src, out, npixels);
+        }
+        double mpix = (double)npixels * n / (now_seconds() - start) * 1e-6;
+        bool same = x == 0 || 0 == memcmp(dst[0], dst[1], npixels * 4);
+        printf("%7s: %8.1f Mpix/s%s\n", layouts[x].name, mpix, same ? "" : " (MISMATCH)");
+        all_ok &= same;
+        skcms_TransformDestroy(xform);
+    }
+
+    free(src);
+    free(dst[0]);
+    free(dst[1]);
+    return all_ok;
+}
+
+// Run the same large transform with each backend this machine supports.
+static bool bench_backends(int n,
+                           const skcms_ICCProfile* src_profile,
+                           const skcms_ICCProfile* dst_profile) {
+    const size_t npixels = 1024 * 1024;
+    uint8_t* src = malloc(npixels * 4);
+    uint8_t* dst = malloc(npixels * 4);
+    expect(src && dst);
+    for (size_t i = 0; i < npixels * 4; i++) {
+        src[i] = (uint8_t)(i * 37 + (i >> 12));
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    const struct { skcms_Backend backend; const char* name; } backends[] = {
+        { skcms_Backend_Baseline, "baseline" },
+        { skcms_Backend_SSE41,    "sse41"    },
+        { skcms_Backend_HSW,      "hsw"      },
+        { skcms_Backend_SKX,      "skx"      },
+    };
+    bool all_ok = true;
+    for (int b = 0; b < 4; b++) {
+        skcms_CompiledTransform* xform = skcms_TransformCreateWithBackend(
+                skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                skcms_PixelFormat_RGBA_8888, upm, dst_profile, backends[b].backend);
+        if (!xform) {
+            printf("%8s: unavailable\n", backends[b].name);
+            continue;
+        }
+
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) {
+            all_ok &= skcms_TransformRun(xform, src, dst, npixels);
+        }
+        double mpix = (double)npixels * n / (now_seconds() - start) * 1e-6;
+        printf("%8s: %8.1f Mpix/s\n", backends[b].name, mpix);
+        skcms_TransformDestroy(xform);
+    }
+
+    free(src);
+    free(dst);
+    return all_ok;
+}
+
+static int by_ticks(const void* x, const void* y) {
+    const skcms_StageProfile* a = x;
+    const skcms_StageProfile* b = y;
+    return a->ticks < b->ticks ? +1
+         : a->ticks > b->ticks ? -1 : 0;
+}
+
+// Print where time went, slowest op first.  Only builds with SKCMS_PROFILE keep track.
+static void print_profile(void) {
+    skcms_StageProfile stages[256];
+    int count = skcms_GetStageProfile(stages, 256);
+    if (count == 0) {
+        printf("No stage profile; build with -DSKCMS_PROFILE.\n");
+        return;
+    }
+    count = count < 256 ? count : 256;
+    qsort(stages, (size_t)count, sizeof(*stages), by_ticks);
+
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += stages[i].ticks;
+    }
+    printf("%24s %12s %14s %6s %10s\n", "op", "calls", "ticks", "%", "ticks/call");
+    for (int i = 0; i < count; i++) {
+        printf("%24s %12llu %14llu %5.1f%% %10.1f\n",
+               stages[i].name,
+               (unsigned long long)stages[i].calls,
+               (unsigned long long)stages[i].ticks,
+               100.0 * (double)stages[i].ticks / (double)total,
+               (double)stages[i].ticks / (double)stages[i].calls);
+    }
+}
+
 int main(int argc, char** argv) {
     int           n = 100000;
+    int     threads = 0;
+    int        grid = 0;
+    bool     interp = false;
+    bool     layout = false;
+    bool   backends = false;
+    bool    profile = false;
     const char* src = NULL;
     const char* dst = NULL;
 
     for (int i = 0; i < argc; i++) {
-        if (0 == strcmp(argv[i], "-n")) { n   = atoi(argv[++i]); }
-        if (0 == strcmp(argv[i], "-s")) { src =      argv[++i] ; }
-        if (0 == strcmp(argv[i], "-d")) { dst =      argv[++i] ; }
+        if (0 == strcmp(argv[i], "-n")) { n       = atoi(argv[++i]); }
+        if (0 == strcmp(argv[i], "-t")) { threads = atoi(argv[++i]); }
+        if (0 == strcmp(argv[i], "-b")) { grid    = atoi(argv[++i]); }
+        if (0 == strcmp(argv[i], "-i")) { interp  = true; }
+        if (0 == strcmp(argv[i], "-l")) { layout  = true; }
+        if (0 == strcmp(argv[i], "-a")) { backends = true; }
+        if (0 == strcmp(argv[i], "-p")) { profile = true; }
+        if (0 == strcmp(argv[i], "-s")) { src     =      argv[++i] ; }
+        if (0 == strcmp(argv[i], "-d")) { dst     =      argv[++i] ; }
     }
 
     // Default to sRGB -> Display P3.
@@ -80,6 +341,25 @@ int main(int argc, char** argv) {
         }
     }
 
+    // With -t, bench a large image with 1, 2, 4, ... up to that many threads instead,
+    // with -b, a large image exactly and baked into a grid of that many points,
+    // with -i, a large image with each kind of CLUT interpolation,
+    // with -l, a large image with each CLUT layout,
+    // or with -a, a large image with each available backend.
+    if (threads > 0 || grid > 0 || interp || layout || backends) {
+        bool ok = threads > 0 ? bench_parallel     (n, threads, &src_profile, &dst_profile)
+                : grid    > 0 ? bench_baked        (n, grid,    &src_profile, &dst_profile)
+                : interp      ? bench_interpolation(n,          &src_profile, &dst_profile)
+                : layout      ? bench_layout       (n,          &src_profile, &dst_profile)
+                :               bench_backends     (n,          &src_profile, &dst_profile);
+        if (profile) {
+            print_profile();
+        }
+        if (src_buf) { free(src_buf); }
+        if (dst_buf) { free(dst_buf); }
+        return ok ? 0 : 1;
+    }
+
     // We'll rotate through pixel formats to get samples from all the various stages.
     skcms_PixelFormat src_fmt = skcms_PixelFormat_RGB_565,
                       dst_fmt = skcms_PixelFormat_RGB_565;
@@ -100,6 +380,11 @@ int main(int argc, char** argv) {
     printf("%d loops in %g clock ticks, %.3g ns / pixel\n",
             n, (double)ticks, (double)ticks / (CLOCKS_PER_SEC * 1e-9) / (n * NPIXELS));
 
+    // With -p, also show how long each op took.
+    if (profile) {
+        print_profile();
+    }
+
     if (src_buf) { free(src_buf); }
     if (dst_buf) { free(dst_buf); }
 
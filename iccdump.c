@@ -489,43 +489,91 @@ static const uint8_t png_signature[] = { 0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1
     }
 #endif
 
+// Parse the profile in an ICC file or .png.  The profile points into *buf.
+static void load_profile(const char* filename, void** buf, skcms_ICCProfile* profile) {
+    size_t len = 0;
+    if (!load_file(filename, buf, &len)) {
+        fatal("Unable to load input file");
+    }
+
+    if (len >= sizeof(png_signature) && 0 == memcmp(*buf, png_signature, sizeof(png_signature))) {
+        if (!parse_png_profile(*buf, len, profile)) {
+            fatal("Could not find an ICC profile in this .png");
+        }
+    } else if (!skcms_Parse(*buf, len, profile)) {
+        fatal("Unable to parse ICC profile");
+    }
+}
+
+// Print the program skcms runs to transform RGBA_8888 pixels from src to dst.
+static void dump_transform(const skcms_ICCProfile* src, const skcms_ICCProfile* dst) {
+    skcms_CompiledTransform* xform =
+        skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, src,
+                              skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, dst);
+    if (!xform) {
+        fatal("Unable to transform between these profiles");
+    }
+
+    skcms_TransformDescription desc;
+    skcms_DescribeTransform(xform, &desc);
+    skcms_TransformDestroy(xform);
+
+    const char* backends[] = { "auto", "baseline", "sse41", "hsw", "skx" };
+    printf("\nRGBA_8888 transform, %s backend, run by %s:\n", backends[desc.backend], desc.path);
+    for (int i = 0; i < desc.op_count; i++) {
+        if (desc.contexts[i][0]) {
+            printf("  %-20s %s\n", desc.ops[i], desc.contexts[i]);
+        } else {
+            printf("  %s\n", desc.ops[i]);
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     const char* filename = NULL;
+    const char* dst_filename = NULL;
     bool svg = false;
     bool desmos = false;
+    bool transform = false;
 
     for (int i = 1; i < argc; ++i) {
         if (0 == strcmp(argv[i], "-s")) {
             svg = true;
         } else if (0 == strcmp(argv[i], "-d")) {
             desmos = true;
+        } else if (0 == strcmp(argv[i], "-t")) {
+            transform = true;
+            if (i + 1 < argc && 0 != strcmp(argv[i+1], "srgb")) {
+                dst_filename = argv[i+1];
+            }
+            i++;
         } else {
             filename = argv[i];
         }
     }
 
     if (!filename) {
-        printf("usage: %s [-s] <ICC filename>\n", argv[0]);
+        printf("usage: %s [-s] [-d] [-t <dst ICC filename>|srgb] <ICC filename>\n", argv[0]);
         return 1;
     }
 
     void* buf = NULL;
-    size_t len = 0;
-    if (!load_file(filename, &buf, &len)) {
-        fatal("Unable to load input file");
-    }
-
     skcms_ICCProfile profile;
-    if (len >= sizeof(png_signature) && 0 == memcmp(buf, png_signature, sizeof(png_signature))) {
-        if (!parse_png_profile(buf, len, &profile)) {
-            fatal("Could not find an ICC profile in this .png");
-        }
-    } else if (!skcms_Parse(buf, len, &profile)) {
-        fatal("Unable to parse ICC profile");
-    }
+    load_profile(filename, &buf, &profile);
 
     dump_profile(&profile, stdout);
 
+    // With -t, show what's run to transform from this profile to another, or to sRGB.
+    if (transform) {
+        void* dst_buf = NULL;
+        skcms_ICCProfile dst = *skcms_sRGB_profile();
+        if (dst_filename) {
+            load_profile(dst_filename, &dst_buf, &dst);
+        }
+        dump_transform(&profile, &dst);
+        free(dst_buf);
+    }
+
     if (desmos) {
         if (profile.has_trc) {
             FILE* fp = desmos_open("TRC_curves.html");
@@ -0,0 +1,3 @@
+mode         = .profile
+extra_cflags = -DSKCMS_PROFILE
+include ninja/clang
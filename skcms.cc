@@ -11,8 +11,36 @@
 #include <assert.h>
 #include <float.h>
 #include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <mutex>
+
+#if defined(SKCMS_PROFILE)
+    #include <chrono>
+#endif
+
+#if !defined(SKCMS_NO_THREADS) && defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    #define SKCMS_NO_THREADS
+#endif
+#if !defined(SKCMS_NO_THREADS)
+    #include <new>
+    #include <thread>
+    #if defined(_WIN32)
+        #include <process.h>
+        #ifndef WIN32_LEAN_AND_MEAN
+            #define WIN32_LEAN_AND_MEAN
+        #endif
+        #ifndef NOMINMAX
+            #define NOMINMAX
+        #endif
+        #include <windows.h>
+    #else
+        #include <pthread.h>
+    #endif
+#endif
 
 #if defined(__ARM_NEON)
     #include <arm_neon.h>
@@ -1791,11 +1819,276 @@ const uint8_t skcms_252_random_bytes[] = {
     112, 36, 224, 136, 202, 76, 94, 98, 175, 213
 };
 
+// Two lanes of MurmurHash3-style mixing, fed 8 bytes at a time.
+class Hasher {
+public:
+    void bytes(const void* ptr, uint64_t len) {
+        const uint8_t* p = (const uint8_t*)ptr;
+        for (; len >= 8; len -= 8, p += 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            this->word(w);
+        }
+        if (len) {
+            uint64_t w = 0;
+            memcpy(&w, p, (size_t)len);
+            this->word(w ^ (len << 56));
+        }
+    }
+    void u32(uint32_t v) { this->word(v); }
+
+    // With contents false, curves(), grid() and profile() skip the contents of tables and grids,
+    // hashing only their sizes and everything else.
+    void curves(const skcms_Curve* curve, uint32_t count, bool contents = true) {
+        for (uint32_t i = 0; i < count; i++, curve++) {
+            this->u32(curve->table_entries);
+            if (curve->table_entries == 0) {
+                this->bytes(&curve->parametric, sizeof(curve->parametric));
+            } else if (curve->table_8) {
+                this->u32(8);
+                if (contents) {
+                    this->bytes(curve->table_8, curve->table_entries);
+                }
+            } else {
+                this->u32(16);
+                if (contents) {
+                    this->bytes(curve->table_16, 2ull*curve->table_entries);
+                }
+            }
+        }
+    }
+
+    void grid(const uint8_t* grid_8, const uint8_t* grid_16,
+              const uint8_t grid_points[4], uint32_t dim, uint32_t output_channels,
+              bool contents = true) {
+        uint64_t entries = output_channels;
+        for (uint32_t i = 0; i < dim; i++) {
+            this->u32(grid_points[i]);
+            entries *= grid_points[i];
+        }
+        if (grid_8) {
+            this->u32(8);
+            if (contents) {
+                this->bytes(grid_8, entries);
+            }
+        } else {
+            this->u32(16);
+            if (contents) {
+                this->bytes(grid_16, 2*entries);
+            }
+        }
+    }
+
+    // Everything parsed from the profile that can affect how it transforms, but not its
+    // ICC buffer or the pointers into it.
+    void profile(const skcms_ICCProfile* p, bool contents = true) {
+        this->u32(p->data_color_space);
+        this->u32(p->pcs);
+
+        this->u32(p->has_trc);
+        if (p->has_trc) {
+            this->curves(p->trc, 3, contents);
+        }
+        this->u32(p->has_toXYZD50);
+        if (p->has_toXYZD50) {
+            this->bytes(&p->toXYZD50, sizeof(p->toXYZD50));
+        }
+        this->u32(p->has_A2B);
+        if (p->has_A2B) {
+            const skcms_A2B& a2b = p->A2B;
+            this->u32(a2b.input_channels);
+            this->u32(a2b.matrix_channels);
+            this->u32(a2b.output_channels);
+            if (a2b.input_channels) {
+                this->curves(a2b.input_curves, a2b.input_channels, contents);
+                this->grid(a2b.grid_8, a2b.grid_16, a2b.grid_points,
+                           a2b.input_channels, a2b.output_channels, contents);
+            }
+            if (a2b.matrix_channels) {
+                this->curves(a2b.matrix_curves, 3, contents);
+                this->bytes(&a2b.matrix, sizeof(a2b.matrix));
+            }
+            this->curves(a2b.output_curves, 3, contents);
+        }
+        this->u32(p->has_B2A);
+        if (p->has_B2A) {
+            const skcms_B2A& b2a = p->B2A;
+            this->u32(b2a.input_channels);
+            this->u32(b2a.matrix_channels);
+            this->u32(b2a.output_channels);
+            this->curves(b2a.input_curves, 3, contents);
+            if (b2a.matrix_channels) {
+                this->bytes(&b2a.matrix, sizeof(b2a.matrix));
+                this->curves(b2a.matrix_curves, 3, contents);
+            }
+            if (b2a.output_channels) {
+                this->grid(b2a.grid_8, b2a.grid_16, b2a.grid_points,
+                           b2a.input_channels, b2a.output_channels, contents);
+                this->curves(b2a.output_curves, b2a.output_channels, contents);
+            }
+        }
+        this->u32(p->has_CICP);
+        if (p->has_CICP) {
+            this->bytes(&p->CICP, sizeof(p->CICP));
+        }
+    }
+
+    skcms_Fingerprint finish() {
+        uint64_t a = fA ^ fLen,
+                 b = fB ^ fLen;
+        a += b;
+        b += a;
+        a = fmix(a);
+        b = fmix(b);
+        a += b;
+        b += a;
+        return {a, b};
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t fmix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ull;
+        k ^= k >> 33;
+        return k;
+    }
+
+    void word(uint64_t w) {
+        const uint64_t c1 = 0x87c37b91114253d5ull,
+                       c2 = 0x4cf5ad432745937full;
+        fA ^= rotl(w * c1, 31) * c2;
+        fA  = rotl(fA, 27) + fB;
+        fA  = fA*5 + 0x52dce729;
+        fB ^= rotl(w * c2, 33) * c1;
+        fB  = rotl(fB, 31) + fA;
+        fB  = fB*5 + 0x38495ab5;
+        fLen += 8;
+    }
+
+    uint64_t fA   = 0x736b636d73000001ull,  // "skcms"
+             fB   = 0x736b636d73000002ull,
+             fLen = 0;
+};
+
+// Whether A and B hold exactly the same parsed fields and table contents, i.e. everything
+// Hasher::profile() looks at, wherever their tables are.  Transforms only read the A2B of
+// their source and the B2A of their destination, so callers that know which role the
+// profiles play can skip comparing the other, often much larger, one.
+static bool profiles_equal(const skcms_ICCProfile* A, const skcms_ICCProfile* B,
+                           bool compare_A2B = true, bool compare_B2A = true) {
+    auto same = [](const void* a, const void* b, uint64_t len) {
+        return 0 == memcmp(a, b, (size_t)len);
+    };
+    auto curves_equal = [&](const skcms_Curve* a, const skcms_Curve* b, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, a++, b++) {
+            const uint32_t n = a->table_entries;
+            if (n != b->table_entries) {
+                return false;
+            }
+            if (n == 0 ? !same(&a->parametric, &b->parametric, sizeof(a->parametric))
+                : a->table_8 ? !b->table_8 || !same(a->table_8, b->table_8, n)
+                : b->table_8 || !same(a->table_16, b->table_16, 2ull*n)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto grids_equal = [&](const uint8_t* a_8, const uint8_t* a_16, const uint8_t a_points[4],
+                           const uint8_t* b_8, const uint8_t* b_16, const uint8_t b_points[4],
+                           uint32_t dim, uint32_t output_channels) {
+        uint64_t entries = output_channels;
+        for (uint32_t i = 0; i < dim; i++) {
+            if (a_points[i] != b_points[i]) {
+                return false;
+            }
+            entries *= a_points[i];
+        }
+        return a_8 ? b_8 && same(a_8, b_8, entries)
+                   : !b_8 && same(a_16, b_16, 2*entries);
+    };
+
+    if (A->data_color_space != B->data_color_space ||
+        A->pcs              != B->pcs              ||
+        A->has_trc          != B->has_trc          ||
+        A->has_toXYZD50     != B->has_toXYZD50     ||
+        A->has_A2B          != B->has_A2B          ||
+        A->has_B2A          != B->has_B2A          ||
+        A->has_CICP         != B->has_CICP) {
+        return false;
+    }
+    if (A->has_trc && !curves_equal(A->trc, B->trc, 3)) {
+        return false;
+    }
+    if (A->has_toXYZD50 && !same(&A->toXYZD50, &B->toXYZD50, sizeof(A->toXYZD50))) {
+        return false;
+    }
+    if (A->has_A2B && compare_A2B) {
+        const skcms_A2B& a = A->A2B;
+        const skcms_A2B& b = B->A2B;
+        if (a.input_channels  != b.input_channels  ||
+            a.matrix_channels != b.matrix_channels ||
+            a.output_channels != b.output_channels) {
+            return false;
+        }
+        if (a.input_channels &&
+            (!curves_equal(a.input_curves, b.input_curves, a.input_channels) ||
+             !grids_equal(a.grid_8, a.grid_16, a.grid_points,
+                          b.grid_8, b.grid_16, b.grid_points,
+                          a.input_channels, a.output_channels))) {
+            return false;
+        }
+        if (a.matrix_channels &&
+            (!curves_equal(a.matrix_curves, b.matrix_curves, 3) ||
+             !same(&a.matrix, &b.matrix, sizeof(a.matrix)))) {
+            return false;
+        }
+        if (!curves_equal(a.output_curves, b.output_curves, 3)) {
+            return false;
+        }
+    }
+    if (A->has_B2A && compare_B2A) {
+        const skcms_B2A& a = A->B2A;
+        const skcms_B2A& b = B->B2A;
+        if (a.input_channels  != b.input_channels  ||
+            a.matrix_channels != b.matrix_channels ||
+            a.output_channels != b.output_channels ||
+            !curves_equal(a.input_curves, b.input_curves, 3)) {
+            return false;
+        }
+        if (a.matrix_channels &&
+            (!same(&a.matrix, &b.matrix, sizeof(a.matrix)) ||
+             !curves_equal(a.matrix_curves, b.matrix_curves, 3))) {
+            return false;
+        }
+        if (a.output_channels &&
+            (!grids_equal(a.grid_8, a.grid_16, a.grid_points,
+                          b.grid_8, b.grid_16, b.grid_points,
+                          a.input_channels, a.output_channels) ||
+             !curves_equal(a.output_curves, b.output_curves, a.output_channels))) {
+            return false;
+        }
+    }
+    return !A->has_CICP || same(&A->CICP, &B->CICP, sizeof(A->CICP));
+}
+
+skcms_Fingerprint skcms_ProfileFingerprint(const skcms_ICCProfile* profile) {
+    Hasher hasher;
+    hasher.profile(profile);
+    return hasher.finish();
+}
+
 bool skcms_ApproximatelyEqualProfiles(const skcms_ICCProfile* A, const skcms_ICCProfile* B) {
     // Test for exactly equal profiles first.
     if (A == B || 0 == memcmp(A,B, sizeof(skcms_ICCProfile))) {
         return true;
     }
+    // Separately parsed copies of the same profile differ only in their pointers.
+    if (profiles_equal(A,B)) {
+        return true;
+    }
 
     // For now this is the essentially the same strategy we use in test_only.c
     // for our skcms_Transform() smoke tests:
@@ -2472,11 +2765,13 @@ bool skcms_ApproximateCurve(const skcms_Curve* curve,
     return isfinitef_(*max_error);
 }
 
-enum class CpuType { Baseline, HSW, SKX };
+enum class CpuType { Baseline, SSE41, HSW, SKX };
 
 static CpuType cpu_type() {
     #if defined(SKCMS_PORTABLE) || !defined(__x86_64__) || defined(SKCMS_FORCE_BASELINE)
         return CpuType::Baseline;
+    #elif defined(SKCMS_FORCE_SSE41)
+        return CpuType::SSE41;
     #elif defined(SKCMS_FORCE_HSW)
         return CpuType::HSW;
     #elif defined(SKCMS_FORCE_SKX)
@@ -2488,10 +2783,15 @@ static CpuType cpu_type() {
             }
             // See http://www.sandpile.org/x86/cpuid.htm
 
-            // First, a basic cpuid(1) lets us check prerequisites for HSW, SKX.
+            // First, a basic cpuid(1) lets us check prerequisites for SSE41, HSW, SKX.
             uint32_t eax, ebx, ecx, edx;
             __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
                                          : "0"(1), "2"(0));
+            CpuType fallback = CpuType::Baseline;
+            if ((ecx & (1u<< 9)) &&  // SSSE3
+                (ecx & (1u<<19))) {  // SSE4.1
+                fallback = CpuType::SSE41;
+            }
             if ((edx & (1u<<25)) &&  // SSE
                 (edx & (1u<<26)) &&  // SSE2
                 (ecx & (1u<< 0)) &&  // SSE3
@@ -2528,12 +2828,169 @@ static CpuType cpu_type() {
                     return CpuType::HSW;
                 }
             }
-            return CpuType::Baseline;
+            return fallback;
         }();
         return type;
     #endif
 }
 
+// Whether we've built cpu's backend, and can run it on this CPU.
+static bool backend_available(CpuType cpu) {
+    #if defined(SKCMS_DISABLE_SSE41)
+        if (cpu == CpuType::SSE41) { return false; }
+    #endif
+    #if defined(SKCMS_DISABLE_HSW)
+        if (cpu == CpuType::HSW) { return false; }
+    #endif
+    #if defined(SKCMS_DISABLE_SKX)
+        if (cpu == CpuType::SKX) { return false; }
+    #endif
+    return cpu <= cpu_type();
+}
+
+// The backend named by SKCMS_BACKEND if it's available, otherwise the best one that is.
+static CpuType default_backend() {
+    static const CpuType backend = []{
+        static const struct { const char* name; CpuType cpu; } kNames[] = {
+            { "baseline", CpuType::Baseline },
+            { "sse41",    CpuType::SSE41    },
+            { "hsw",      CpuType::HSW      },
+            { "skx",      CpuType::SKX      },
+        };
+    #if defined(_MSC_VER)
+        #pragma warning(push)
+        #pragma warning(disable: 4996)  // getenv() is "unsafe".
+    #endif
+        const char* env = getenv("SKCMS_BACKEND");
+    #if defined(_MSC_VER)
+        #pragma warning(pop)
+    #endif
+        for (auto n : kNames) {
+            if (env && 0 == strcmp(env, n.name) && backend_available(n.cpu)) {
+                return n.cpu;
+            }
+        }
+        CpuType cpu = cpu_type();
+        while (!backend_available(cpu)) {
+            cpu = (CpuType)((int)cpu - 1);
+        }
+        return cpu;
+    }();
+    return backend;
+}
+
+// Set by skcms_SetBackend(), or -1 to use default_backend().
+static std::atomic<int> gBackend{-1};
+
+// The backend new transforms use.
+static CpuType current_backend() {
+    const int backend = gBackend.load();
+    return backend < 0 ? default_backend() : (CpuType)backend;
+}
+
+// skcms_Backend lists the same backends as CpuType, in the same order, after Auto.
+static bool backend_cpu_type(skcms_Backend backend, CpuType* cpu) {
+    if (backend == skcms_Backend_Auto) {
+        *cpu = current_backend();
+        return true;
+    }
+    if (backend < skcms_Backend_Baseline || backend > skcms_Backend_SKX) {
+        return false;
+    }
+    *cpu = (CpuType)(backend - skcms_Backend_Baseline);
+    return backend_available(*cpu);
+}
+
+static skcms_Backend public_backend(CpuType cpu) {
+    return (skcms_Backend)(skcms_Backend_Baseline + (int)cpu);
+}
+
+bool skcms_IsBackendAvailable(skcms_Backend backend) {
+    CpuType cpu;
+    return backend_cpu_type(backend, &cpu);
+}
+
+bool skcms_SetBackend(skcms_Backend backend) {
+    if (backend == skcms_Backend_Auto) {
+        gBackend.store(-1);
+        return true;
+    }
+    CpuType cpu;
+    if (!backend_cpu_type(backend, &cpu)) {
+        return false;
+    }
+    gBackend.store((int)cpu);
+    return true;
+}
+
+skcms_Backend skcms_GetBackend() {
+    return public_backend(current_backend());
+}
+
+static const char* op_name(Op op) {
+    static const char* kNames[] = {
+    #define M(name) #name,
+    #define M2(name, n) #name,
+        SKCMS_WORK_OPS(M)        SKCMS_STORE_OPS(M)
+        SKCMS_FUSED_WORK_OPS(M2) SKCMS_FUSED_STORE_OPS(M2)
+    #undef M
+    #undef M2
+    };
+    return kNames[(int)op];
+}
+
+// Profiling builds time every op of every program they run.  So that each op is seen and
+// timed on its own, they skip fused ops, kernels, and build_fast_paths().
+#if defined(SKCMS_PROFILE)
+    static constexpr bool kProfiling = true;
+
+    static std::atomic<uint64_t> gStageCalls[kOpCount],
+                                 gStageTicks[kOpCount];
+
+    uint64_t skcms_private::profile_ticks() {
+    #if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+        return __builtin_ia32_rdtsc();
+    #else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    #endif
+    }
+
+    void skcms_private::record_stage(Op op, uint64_t ticks) {
+        gStageCalls[(int)op].fetch_add(1,     std::memory_order_relaxed);
+        gStageTicks[(int)op].fetch_add(ticks, std::memory_order_relaxed);
+    }
+
+    int skcms_GetStageProfile(skcms_StageProfile* stages, int count) {
+        int ran = 0;
+        for (int op = 0; op < kOpCount; op++) {
+            const uint64_t calls = gStageCalls[op].load(std::memory_order_relaxed);
+            if (calls == 0) {
+                continue;
+            }
+            if (ran < count) {
+                stages[ran].name  = op_name((Op)op);
+                stages[ran].calls = calls;
+                stages[ran].ticks = gStageTicks[op].load(std::memory_order_relaxed);
+            }
+            ran++;
+        }
+        return ran;
+    }
+
+    void skcms_ResetStageProfile() {
+        for (int op = 0; op < kOpCount; op++) {
+            gStageCalls[op].store(0, std::memory_order_relaxed);
+            gStageTicks[op].store(0, std::memory_order_relaxed);
+        }
+    }
+#else
+    static constexpr bool kProfiling = false;
+
+    int  skcms_GetStageProfile(skcms_StageProfile*, int) { return 0; }
+    void skcms_ResetStageProfile() {}
+#endif
+
 static bool tf_is_gamma(const skcms_TransferFunction& tf) {
     return tf.g > 0 && tf.a == 1 &&
            tf.b == 0 && tf.c == 0 && tf.d == 0 && tf.e == 0 && tf.f == 0;
@@ -2655,6 +3112,24 @@ static size_t bytes_per_pixel(skcms_PixelFormat fmt) {
         case skcms_PixelFormat_RGBA_hhhh        >> 1: return  8;
         case skcms_PixelFormat_RGB_fff          >> 1: return 12;
         case skcms_PixelFormat_RGBA_ffff        >> 1: return 16;
+
+        case skcms_PixelFormat_RGB_888_Planar         >> 1: return  3;
+        case skcms_PixelFormat_RGBA_8888_Planar       >> 1: return  4;
+        case skcms_PixelFormat_RGB_161616LE_Planar    >> 1: return  6;
+        case skcms_PixelFormat_RGBA_16161616LE_Planar >> 1: return  8;
+        case skcms_PixelFormat_RGB_hhh_Planar         >> 1: return  6;
+        case skcms_PixelFormat_RGBA_hhhh_Planar       >> 1: return  8;
+        case skcms_PixelFormat_RGB_fff_Planar         >> 1: return 12;
+        case skcms_PixelFormat_RGBA_ffff_Planar       >> 1: return 16;
+
+        // Subsampled YCbCr formats average out to fewer bytes per pixel than this, but no
+        // more, which is all that matters for the uses we have for bytes_per_pixel().
+        case skcms_PixelFormat_YCbCr_444_888    >> 1: return  3;
+        case skcms_PixelFormat_YCbCr_444_161616 >> 1: return  6;
+        case skcms_PixelFormat_YCbCr_422_888    >> 1: return  2;
+        case skcms_PixelFormat_YCbCr_420_888    >> 1: return  2;
+        case skcms_PixelFormat_YCbCr_420_88     >> 1: return  2;
+        case skcms_PixelFormat_YCbCr_420_1616   >> 1: return  4;
     }
     assert(false);
     return 0;
@@ -2674,6 +3149,74 @@ static bool has_cicp_hlg_trc(const skcms_ICCProfile* profile) {
         && profile->CICP.transfer_characteristics == kTransferCicpIdHLG;
 }
 
+static bool is_ycbcr(skcms_PixelFormat fmt) {
+    return fmt >= skcms_PixelFormat_YCbCr_444_888;
+}
+
+// Build the matrix converting Y, Cb, Cr (or Y, Cr, Cb), as loaded from fmt, to R'G'B'.
+// See ITU-T H.273 Table 4 for the full list of matrix_coefficients codes.
+static bool ycbcr_to_rgb_matrix(const skcms_ICCProfile* profile, skcms_PixelFormat fmt,
+                                skcms_Matrix3x4* m) {
+    uint8_t matrix_coefficients = 1;  // BT.709 unless told otherwise.
+    bool    full_range          = false;
+    if (profile->has_CICP) {
+        matrix_coefficients = profile->CICP.matrix_coefficients;
+        full_range          = profile->CICP.video_full_range_flag != 0;
+    }
+
+    bool identity = false;
+    float kr = 0, kb = 0;
+    switch (matrix_coefficients) {
+        case 0:          identity = true;             break;  // GBR, i.e. Y=G, Cb=B, Cr=R.
+        case 1: case 2:  kr = 0.2126f; kb = 0.0722f;  break;  // BT.709, or unspecified.
+        case 5: case 6:  kr = 0.299f;  kb = 0.114f;   break;  // BT.601.
+        case 9:          kr = 0.2627f; kb = 0.0593f;  break;  // BT.2020 non-constant luminance.
+        default: return false;
+    }
+
+    // Expand Y to y in [0,1] and Cb,Cr to cb,cr in [-0.5,0.5], each as v*scale + bias.
+    // 16-bit formats hold code values shifted up by 8 bits; the normalized math is the same.
+    const bool  sixteen = (fmt >> 1) == (skcms_PixelFormat_YCbCr_444_161616 >> 1)
+                       || (fmt >> 1) == (skcms_PixelFormat_YCbCr_420_1616   >> 1);
+    const float one     = sixteen ? 65535.0f : 255.0f,
+                unit    = sixteen ?   256.0f :   1.0f;
+
+    float y_scale = 1, y_bias = 0,
+          c_scale = 1, c_bias = identity ? 0 : -128 * unit / one;
+    if (!full_range) {
+        y_scale = one / (219 * unit);
+        y_bias  = -16 * unit / one * y_scale;
+        c_scale = identity ? y_scale : one / (224 * unit);
+        c_bias  = identity ? y_bias  : -128 * unit / one * c_scale;
+    }
+
+    // Each row of coefficients for y, cb, cr.
+    float rows[3][3];
+    if (identity) {
+        const float I[3][3] = {{0,0,1}, {1,0,0}, {0,1,0}};
+        memcpy(rows, I, sizeof(rows));
+    } else {
+        const float kg = 1 - kr - kb;
+        const float K[3][3] = {
+            { 1,                          0, 2*(1-kr)        },
+            { 1, -2*kb*(1-kb)/kg, -2*kr*(1-kr)/kg },
+            { 1,               2*(1-kb),                0    },
+        };
+        memcpy(rows, K, sizeof(rows));
+    }
+
+    const bool crcb = fmt & 1;
+    for (int r = 0; r < 3; r++) {
+        const float cb = rows[r][1],
+                    cr = rows[r][2];
+        m->vals[r][0] = rows[r][0] * y_scale;
+        m->vals[r][1] = (crcb ? cr : cb) * c_scale;
+        m->vals[r][2] = (crcb ? cb : cr) * c_scale;
+        m->vals[r][3] = rows[r][0] * y_bias + (cb + cr) * c_bias;
+    }
+    return true;
+}
+
 // Set tf to be the PQ transfer function, scaled such that 1.0 will map to 10,000 / 203.
 static void set_reference_pq_ish_trc(skcms_TransferFunction* tf) {
     // Initialize such that 1.0 maps to 1.0.
@@ -2752,77 +3295,102 @@ static bool prep_for_destination(const skcms_ICCProfile* profile,
         && skcms_TransferFunction_invert(&profile->trc[2].parametric, invB);
 }
 
-bool skcms_Transform(const void*             src,
-                     skcms_PixelFormat       srcFmt,
-                     skcms_AlphaFormat       srcAlpha,
-                     const skcms_ICCProfile* srcProfile,
-                     void*                   dst,
-                     skcms_PixelFormat       dstFmt,
-                     skcms_AlphaFormat       dstAlpha,
-                     const skcms_ICCProfile* dstProfile,
-                     size_t                  nz) {
-    const size_t dst_bpp = bytes_per_pixel(dstFmt),
-                 src_bpp = bytes_per_pixel(srcFmt);
-    // Let's just refuse if the request is absurdly big.
-    if (nz * dst_bpp > INT_MAX || nz * src_bpp > INT_MAX) {
-        return false;
-    }
-    int n = (int)nz;
-
-    // Null profiles default to sRGB. Passing null for both is handy when doing format conversion.
-    if (!srcProfile) {
-        srcProfile = skcms_sRGB_profile();
-    }
-    if (!dstProfile) {
-        dstProfile = skcms_sRGB_profile();
-    }
-
-    // We can't transform in place unless the PixelFormats are the same size.
-    if (dst == src && dst_bpp != src_bpp) {
-        return false;
-    }
-    // TODO: more careful alias rejection (like, dst == src + 1)?
-
-    Op          program[32];
-    const void* context[32];
-
-    Op*          ops      = program;
-    const void** contexts = context;
-
-    auto add_op = [&](Op o) {
-        *ops++ = o;
-        *contexts++ = nullptr;
-    };
-
-    auto add_op_ctx = [&](Op o, const void* c) {
-        *ops++ = o;
-        *contexts++ = c;
-    };
-
-    auto add_curve_ops = [&](const skcms_Curve* curves, int numChannels) -> bool {
-        OpAndArg oa[4];
-        assert(numChannels <= ARRAY_COUNT(oa));
-
-        int numOps = select_curve_ops(curves, numChannels, oa);
-        if (numOps < 0) {
-            return false;
-        }
+using RunLowpFn     = decltype(&baseline::run_program_lowp);
+using RunByteLUTsFn = decltype(&baseline::run_byte_luts);
+
+// The parts of a compiled transform that only fast paths or skcms_TransformCreate*() use.
+// They're allocated separately so that skcms_Transform() can keep its skcms_CompiledTransform
+// on the stack small, only paying for these when it has enough pixels to want fast paths.
+struct TransformExtras {
+    // Contexts for table_small_* ops made by select_table_ops().
+    SmallTable      small_tables[8];
+    int             small_table_count;
+
+    // The floats decode_tables() makes for table_luts, and the grids pack_cluts() repacks.
+    float*          decoded_tables;
+    uint8_t*        packed_grids;
+
+    // When use_byte_luts is set, these replace running the program; see build_byte_luts().
+    bool            use_byte_luts;
+    RunByteLUTsFn   run_byte_luts;
+    ByteLUTs        byte_luts;
+
+    // When use_lowp is set, this 16-bit fixed point program replaces the float one; see
+    // build_lowp().  lowp_storage holds its matrix and curve tables.
+    bool            use_lowp;
+    RunLowpFn       run_lowp;
+    LowpOp          lowp_program[32];
+    const void*     lowp_contexts[32];
+    ptrdiff_t       lowp_program_size;
+    void*           lowp_storage;
+
+    // When jit.code is set, this machine code replaces the float program; see build_jit().
+    jit::Program    jit;
+
+    // Only used by skcms_TransformCreateBaked(): the whole color conversion, sampled.
+    BakedLUT        baked_lut;
+
+    // Only used by skcms_TransformCreate(): private copies of the source and destination
+    // profiles, and a single allocation holding every curve table and CLUT grid they use.
+    // (Baked transforms keep their BakedLUT's table there instead.)
+    skcms_ICCProfile src_profile,
+                     dst_profile;
+    void*            owned_tables;
+};
 
-        for (int i = 0; i < numOps; ++i) {
-            add_op_ctx(oa[i].op, oa[i].arg);
-        }
-        return true;
-    };
+// Everything skcms_Transform() works out from its format, alpha, and profile arguments:
+// the program of Ops, their contexts, and the backend that will run them.
+struct skcms_CompiledTransform {
+    Op           program[32];
+    const void*  contexts[32];
+    ptrdiff_t    program_size;
+    size_t       src_bpp,
+                 dst_bpp;
+    RunProgramFn run;
+
+    // How planar formats' planes are laid out, and for 4:2:0 YCbCr, the log2 vertical
+    // subsampling of src's chroma planes.  Interleaved formats have 0 planes.
+    PlanarLayout src_layout,
+                 dst_layout;
+    int          src_chroma_vshift;
+
+    // Converts YCbCr sources to R'G'B'.
+    skcms_Matrix3x4 ycbcr_to_rgb;
+
+    // What run_span() executes: program with common sequences of ops replaced by fused ops,
+    // which read the same contexts.  See fuse_program().
+    Op           fused_program[32];
+    ptrdiff_t    fused_program_size;
+
+    // A kernel specialized for exactly this program, run instead of run when non-null.
+    RunProgramFn kernel;
+
+    // The backend that run, kernel, and any lowp or JIT fast path were chosen for.
+    CpuType      cpu;
+
+    // Matrices made by optimize_program(), folding together matrix ops and swap_rb.
+    skcms_Matrix3x3 folded_3x3[4];
+    skcms_Matrix3x4 folded_3x4[4];
+    int             folded_3x3_count,
+                    folded_3x4_count;
+
+    // Contexts for table_* ops made by select_table_ops().
+    TableLUT        table_luts[32];
+    int             table_lut_count;
+
+    // Contexts for clut_* ops, one for the source A2B and one for the destination B2A.
+    CLUT            cluts[2];
+    int             clut_count;
+
+    // Fast paths and private copies that skcms_Transform() usually does without, or null.
+    TransformExtras*       extras;
 
     // If the source has a TRC that is specified by CICP and not the TRC
     // entries, then store it here for future use.
     skcms_TransferFunction src_cicp_trc;
 
     // These are always parametric curves of some sort.
-    skcms_Curve dst_curves[3];
-    dst_curves[0].table_entries =
-    dst_curves[1].table_entries =
-    dst_curves[2].table_entries = 0;
+    skcms_Curve            dst_curves[3];
 
     // This will store the XYZD50 to destination gamut conversion matrix, if it is needed.
     skcms_Matrix3x3        dst_from_xyz;
@@ -2830,204 +3398,915 @@ bool skcms_Transform(const void*             src,
     // This will store the full source to destination gamut conversion matrix, if it is needed.
     skcms_Matrix3x3        dst_from_src;
 
-    switch (srcFmt >> 1) {
-        default: return false;
-        case skcms_PixelFormat_A_8              >> 1: add_op(Op::load_a8);          break;
-        case skcms_PixelFormat_G_8              >> 1: add_op(Op::load_g8);          break;
-        case skcms_PixelFormat_GA_88            >> 1: add_op(Op::load_ga88);        break;
-        case skcms_PixelFormat_ABGR_4444        >> 1: add_op(Op::load_4444);        break;
-        case skcms_PixelFormat_RGB_565          >> 1: add_op(Op::load_565);         break;
-        case skcms_PixelFormat_RGB_888          >> 1: add_op(Op::load_888);         break;
-        case skcms_PixelFormat_RGBA_8888        >> 1: add_op(Op::load_8888);        break;
-        case skcms_PixelFormat_RGBA_1010102     >> 1: add_op(Op::load_1010102);     break;
-        case skcms_PixelFormat_RGB_101010x_XR   >> 1: add_op(Op::load_101010x_XR);  break;
-        case skcms_PixelFormat_RGBA_10101010_XR >> 1: add_op(Op::load_10101010_XR); break;
-        case skcms_PixelFormat_RGB_161616LE     >> 1: add_op(Op::load_161616LE);    break;
-        case skcms_PixelFormat_RGBA_16161616LE  >> 1: add_op(Op::load_16161616LE);  break;
-        case skcms_PixelFormat_RGB_161616BE     >> 1: add_op(Op::load_161616BE);    break;
-        case skcms_PixelFormat_RGBA_16161616BE  >> 1: add_op(Op::load_16161616BE);  break;
-        case skcms_PixelFormat_RGB_hhh_Norm     >> 1: add_op(Op::load_hhh);         break;
-        case skcms_PixelFormat_RGBA_hhhh_Norm   >> 1: add_op(Op::load_hhhh);        break;
-        case skcms_PixelFormat_RGB_hhh          >> 1: add_op(Op::load_hhh);         break;
-        case skcms_PixelFormat_RGBA_hhhh        >> 1: add_op(Op::load_hhhh);        break;
-        case skcms_PixelFormat_RGB_fff          >> 1: add_op(Op::load_fff);         break;
-        case skcms_PixelFormat_RGBA_ffff        >> 1: add_op(Op::load_ffff);        break;
+    // A copy of the destination profile with an identity gamut, when transforming to gray.
+    skcms_ICCProfile       gray_dst_profile;
 
-        case skcms_PixelFormat_RGBA_8888_sRGB >> 1:
-            add_op(Op::load_8888);
-            add_op_ctx(Op::tf_rgb, skcms_sRGB_TransferFunction());
+    // Only used by the transform cache: one reference for the cache, plus one for each caller
+    // currently running this transform.  The last to let go destroys it.
+    std::atomic<int>       refs;
+};
+
+static RunProgramFn select_kernel(CpuType cpu, const Op* program, ptrdiff_t programSize) {
+    auto find = baseline::find_kernel;
+    switch (cpu) {
+        case CpuType::SKX:
+            #if !defined(SKCMS_DISABLE_SKX)
+                find = skx::find_kernel;
+                break;
+            #endif
+
+        case CpuType::HSW:
+            #if !defined(SKCMS_DISABLE_HSW)
+                find = hsw::find_kernel;
+                break;
+            #endif
+
+        case CpuType::SSE41:
+            #if !defined(SKCMS_DISABLE_SSE41)
+                find = sse41::find_kernel;
+                break;
+            #endif
+
+        case CpuType::Baseline:
             break;
     }
-    if (srcFmt == skcms_PixelFormat_RGB_hhh_Norm ||
-        srcFmt == skcms_PixelFormat_RGBA_hhhh_Norm) {
-        add_op(Op::clamp);
-    }
-    if (srcFmt & 1) {
-        add_op(Op::swap_rb);
-    }
-    skcms_ICCProfile gray_dst_profile;
-    switch (dstFmt >> 1) {
-        case skcms_PixelFormat_G_8:
-        case skcms_PixelFormat_GA_88:
-            // When transforming to gray, stop at XYZ (by setting toXYZ to identity), then transform
-            // luminance (Y) by the destination transfer function.
-            gray_dst_profile = *dstProfile;
-            skcms_SetXYZD50(&gray_dst_profile, &skcms_XYZD50_profile()->toXYZD50);
-            dstProfile = &gray_dst_profile;
-            break;
-        default:
+    return find(program, programSize);
+}
+
+static RunProgramFn select_backend(CpuType cpu) {
+    auto run = baseline::run_program;
+    switch (cpu) {
+        case CpuType::SKX:
+            #if !defined(SKCMS_DISABLE_SKX)
+                run = skx::run_program;
+                break;
+            #endif
+
+        case CpuType::HSW:
+            #if !defined(SKCMS_DISABLE_HSW)
+                run = hsw::run_program;
+                break;
+            #endif
+
+        case CpuType::SSE41:
+            #if !defined(SKCMS_DISABLE_SSE41)
+                run = sse41::run_program;
+                break;
+            #endif
+
+        case CpuType::Baseline:
             break;
     }
+    return run;
+}
 
-    if (srcProfile->data_color_space == skcms_Signature_CMYK) {
-        // Photoshop creates CMYK images as inverse CMYK.
-        // These happen to be the only ones we've _ever_ seen.
-        add_op(Op::invert);
-        // With CMYK, ignore the alpha type, to avoid changing K or conflating CMY with K.
-        srcAlpha = skcms_AlphaFormat_Unpremul;
+static RunByteLUTsFn select_byte_luts_backend(CpuType cpu) {
+    auto run = baseline::run_byte_luts;
+    switch (cpu) {
+        case CpuType::SKX:
+            #if !defined(SKCMS_DISABLE_SKX)
+                run = skx::run_byte_luts;
+                break;
+            #endif
+
+        case CpuType::HSW:
+            #if !defined(SKCMS_DISABLE_HSW)
+                run = hsw::run_byte_luts;
+                break;
+            #endif
+
+        case CpuType::SSE41:
+            #if !defined(SKCMS_DISABLE_SSE41)
+                run = sse41::run_byte_luts;
+                break;
+            #endif
+
+        case CpuType::Baseline:
+            break;
     }
+    return run;
+}
 
-    if (srcAlpha == skcms_AlphaFormat_Opaque) {
-        add_op(Op::force_opaque);
-    } else if (srcAlpha == skcms_AlphaFormat_PremulAsEncoded) {
-        add_op(Op::unpremul);
+// Returns null when the float backend is at least as fast.
+static RunLowpFn select_lowp_backend(CpuType cpu) {
+    RunLowpFn run = baseline::run_program_lowp;
+    switch (cpu) {
+        case CpuType::SKX:
+            #if !defined(SKCMS_DISABLE_SKX)
+                run = nullptr;
+                break;
+            #endif
+
+        case CpuType::HSW:
+            #if !defined(SKCMS_DISABLE_HSW)
+                run = hsw::run_program_lowp;
+                break;
+            #endif
+
+        case CpuType::SSE41:
+            #if !defined(SKCMS_DISABLE_SSE41)
+                run = sse41::run_program_lowp;
+                break;
+            #endif
+
+        case CpuType::Baseline:
+            break;
     }
+    return run;
+}
 
-    if (dstProfile != srcProfile) {
+// Plain globals: skcms_SetOptimizerHook() is documented to be called only while no transforms
+// are being built, so these never change under optimize_program().
+static skcms_OptimizerHook* gOptimizerHook     = nullptr;
+static void*                gOptimizerHookCtx  = nullptr;
 
-        // Track whether or not the A2B or B2A transforms are used. the CICP
-        // values take precedence over A2B and B2A.
-        bool src_using_A2B = false;
-        bool src_using_hlg_ootf = false;
-        bool dst_using_B2A = false;
-        bool dst_using_hlg_ootf = false;
+void skcms_SetOptimizerHook(skcms_OptimizerHook* fn, void* ctx) {
+    gOptimizerHook    = fn;
+    gOptimizerHookCtx = ctx;
+}
 
-        if (!prep_for_destination(dstProfile,
-                                  &dst_from_xyz,
-                                  &dst_curves[0].parametric,
-                                  &dst_curves[1].parametric,
-                                  &dst_curves[2].parametric,
-                                  &dst_using_B2A,
-                                  &dst_using_hlg_ootf)) {
+// Loads whose channels are always within [0,1], making a clamp right after them a no-op.
+static bool loads_unorm(Op op) {
+    switch (op) {
+        case Op::load_a8:            case Op::load_g8:          case Op::load_ga88:
+        case Op::load_4444:          case Op::load_565:         case Op::load_888:
+        case Op::load_8888:          case Op::load_1010102:
+        case Op::load_161616LE:      case Op::load_16161616LE:
+        case Op::load_161616BE:      case Op::load_16161616BE:
+        case Op::load_planar_888:    case Op::load_planar_8888:
+        case Op::load_planar_161616: case Op::load_planar_16161616:
+            return true;
+        default:
             return false;
-        }
+    }
+}
 
-        if (has_cicp_pq_trc(srcProfile) && srcProfile->has_toXYZD50) {
-            set_reference_pq_ish_trc(&src_cicp_trc);
-            add_op_ctx(Op::pq_rgb, &src_cicp_trc);
-        } else if (has_cicp_hlg_trc(srcProfile) && srcProfile->has_toXYZD50) {
-            src_using_hlg_ootf = true;
-            set_sdr_hlg_ish_trc(&src_cicp_trc);
-            add_op_ctx(Op::hlg_rgb, &src_cicp_trc);
-        } else if (srcProfile->has_A2B) {
-            src_using_A2B = true;
-            if (srcProfile->A2B.input_channels) {
-                if (!add_curve_ops(srcProfile->A2B.input_curves,
-                              (int)srcProfile->A2B.input_channels)) {
-                    return false;
-                }
-                add_op(Op::clamp);
-                add_op_ctx(Op::clut_A2B, &srcProfile->A2B);
-            }
+// Ops that treat r and b alike, so a swap_rb can move from one side of them to the other.
+static bool commutes_with_swap_rb(Op op) {
+    switch (op) {
+        case Op::clamp:     case Op::invert:  case Op::force_opaque:
+        case Op::premul:    case Op::unpremul:
+        case Op::gamma_rgb: case Op::tf_rgb:  case Op::pq_rgb:
+        case Op::hlg_rgb:   case Op::hlginv_rgb:
+            return true;
+        default:
+            return false;
+    }
+}
 
-            if (srcProfile->A2B.matrix_channels == 3) {
-                if (!add_curve_ops(srcProfile->A2B.matrix_curves, /*numChannels=*/3)) {
-                    return false;
-                }
+// Ops that leave alpha at 1 when it is already, so a force_opaque after them and an earlier
+// force_opaque does nothing.
+static bool keeps_opaque(Op op) {
+    switch (op) {
+        case Op::swap_rb:       case Op::clamp:         case Op::premul:
+        case Op::unpremul:      case Op::matrix_3x3:    case Op::matrix_3x4:
+        case Op::gamma_r:       case Op::gamma_g:       case Op::gamma_b:   case Op::gamma_rgb:
+        case Op::tf_r:          case Op::tf_g:          case Op::tf_b:      case Op::tf_rgb:
+        case Op::table_r:       case Op::table_g:       case Op::table_b:
+        case Op::table_small_r: case Op::table_small_g: case Op::table_small_b:
+            return true;
+        default:
+            return false;
+    }
+}
 
-                static const skcms_Matrix3x4 I = {{
-                    {1,0,0,0},
-                    {0,1,0,0},
-                    {0,0,1,0},
-                }};
-                if (0 != memcmp(&I, &srcProfile->A2B.matrix, sizeof(I))) {
-                    add_op_ctx(Op::matrix_3x4, &srcProfile->A2B.matrix);
-                }
-            }
+static bool is_matrix(Op op) {
+    return op == Op::matrix_3x3 || op == Op::matrix_3x4;
+}
 
-            if (srcProfile->A2B.output_channels == 3) {
-                if (!add_curve_ops(srcProfile->A2B.output_curves, /*numChannels=*/3)) {
-                    return false;
-                }
-            }
+static skcms_Matrix3x4 matrix_3x4(Op op, const void* ctx) {
+    if (op == Op::matrix_3x4) {
+        return *(const skcms_Matrix3x4*)ctx;
+    }
+    const skcms_Matrix3x3* m = (const skcms_Matrix3x3*)ctx;
+    return {{
+        { m->vals[0][0], m->vals[0][1], m->vals[0][2], 0 },
+        { m->vals[1][0], m->vals[1][1], m->vals[1][2], 0 },
+        { m->vals[2][0], m->vals[2][1], m->vals[2][2], 0 },
+    }};
+}
 
-            if (srcProfile->pcs == skcms_Signature_Lab) {
-                add_op(Op::lab_to_xyz);
-            }
+// The transfer function a tf_rgb or gamma_rgb op applies to every channel.
+static const skcms_TransferFunction* rgb_curve(Op op, const void* ctx) {
+    return op == Op::tf_rgb || op == Op::gamma_rgb ? (const skcms_TransferFunction*)ctx
+                                                   : nullptr;
+}
 
-        } else if (srcProfile->has_trc && srcProfile->has_toXYZD50) {
-            if (!add_curve_ops(srcProfile->trc, /*numChannels=*/3)) {
+// Whether tf is increasing and maps 0 to 0 and 1 to 1, so clamping to [0,1] before or after
+// applying it gives the same result.
+static bool commutes_with_clamp(const skcms_TransferFunction* tf) {
+    return tf
+        && classify(*tf) == skcms_TFType_sRGBish
+        && tf->g > 0 && tf->a > 0 && tf->c >= 0
+        && skcms_TransferFunction_eval(tf, 0.0f) == 0.0f
+        && fabsf_(skcms_TransferFunction_eval(tf, 1.0f) - 1.0f) < 1/65536.0f;
+}
+
+// Whether B is A's inverse, as skcms_TransferFunction_invert() would find it, to within float
+// rounding of each parameter, so that applying A then B changes nothing.
+static bool cancel_out(const skcms_TransferFunction* A, const skcms_TransferFunction* B) {
+    skcms_TransferFunction inv;
+    if (!A || !B || classify(*A) != skcms_TFType_sRGBish
+                 || classify(*B) != skcms_TFType_sRGBish
+                 || !skcms_TransferFunction_invert(A, &inv)) {
+        return false;
+    }
+    const float want[] = { inv.g, inv.a, inv.b, inv.c, inv.d, inv.e, inv.f },
+                got [] = {  B->g,  B->a,  B->b,  B->c,  B->d,  B->e,  B->f };
+    for (int i = 0; i < ARRAY_COUNT(want); i++) {
+        if (!(fabsf_(got[i] - want[i]) <= FLT_EPSILON * (1 + fabsf_(want[i])))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rewrite xform's program into a shorter, equivalent one: fold adjacent matrices together,
+// cancel curves followed by their inverse, drop redundant clamps and force_opaques, and fold
+// swap_rb into matrices or cancel pairs of them.  Clamps and swaps move later through ops they
+// commute with to meet these rewrites.  The load and store ops at either end never change.
+static void optimize_program(skcms_CompiledTransform* xform) {
+    Op*          ops = xform->program;
+    const void** ctx = xform->contexts;
+    ptrdiff_t    n   = xform->program_size;
+    const ptrdiff_t before = n;
+
+    xform->folded_3x3_count = 0;
+    xform->folded_3x4_count = 0;
+
+    auto erase = [&](ptrdiff_t i) {
+        memmove(ops + i, ops + i + 1, (size_t)(n - i - 1) * sizeof(*ops));
+        memmove(ctx + i, ctx + i + 1, (size_t)(n - i - 1) * sizeof(*ctx));
+        n--;
+    };
+    auto swap_ops = [&](ptrdiff_t i) {
+        Op          op = ops[i]; ops[i] = ops[i+1]; ops[i+1] = op;
+        const void* c  = ctx[i]; ctx[i] = ctx[i+1]; ctx[i+1] = c;
+    };
+    // Replace the op at i with m, a matrix_3x3 if it has no offsets, or fail if out of room.
+    auto set_matrix = [&](ptrdiff_t i, const skcms_Matrix3x4& m) {
+        if (m.vals[0][3] == 0 && m.vals[1][3] == 0 && m.vals[2][3] == 0) {
+            if (xform->folded_3x3_count == ARRAY_COUNT(xform->folded_3x3)) {
                 return false;
             }
-        } else {
+            skcms_Matrix3x3* m33 = &xform->folded_3x3[xform->folded_3x3_count++];
+            for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++) {
+                m33->vals[r][c] = m.vals[r][c];
+            }
+            ops[i] = Op::matrix_3x3;
+            ctx[i] = m33;
+            return true;
+        }
+        if (xform->folded_3x4_count == ARRAY_COUNT(xform->folded_3x4)) {
             return false;
         }
+        skcms_Matrix3x4* m34 = &xform->folded_3x4[xform->folded_3x4_count++];
+        *m34 = m;
+        ops[i] = Op::matrix_3x4;
+        ctx[i] = m34;
+        return true;
+    };
 
-        // A2B sources are in XYZD50 by now, but TRC sources are still in their original gamut.
-        assert (srcProfile->has_A2B || srcProfile->has_toXYZD50);
+    for (bool changed = true; changed; ) {
+        changed = false;
 
-        if (dst_using_B2A) {
-            // B2A needs its input in XYZD50, so transform TRC sources now.
-            if (!src_using_A2B) {
-                add_op_ctx(Op::matrix_3x3, &srcProfile->toXYZD50);
-                // Apply the HLG OOTF in XYZD50 space, if needed.
-                if (src_using_hlg_ootf) {
-                    add_op(Op::hlg_ootf_scale);
+        if (n > 2 && ops[1] == Op::clamp && loads_unorm(ops[0])) {
+            erase(1);
+            changed = true;
+            continue;
+        }
+
+        for (ptrdiff_t i = 1; i + 2 < n && !changed; i++) {
+            const Op x = ops[i],
+                     y = ops[i+1];
+            changed = true;
+            if ((x == Op::clamp   && y == Op::clamp) ||
+                (x == Op::swap_rb && y == Op::swap_rb)) {
+                erase(i+1);
+                if (x == Op::swap_rb) {
+                    erase(i);
+                }
+            } else if (cancel_out(rgb_curve(x, ctx[i]), rgb_curve(y, ctx[i+1]))) {
+                erase(i+1);
+                erase(i);
+            } else if (is_matrix(x) && is_matrix(y)) {
+                // Applying A then B is B*A, with B's offsets plus B applied to A's.
+                const skcms_Matrix3x4 A = matrix_3x4(x, ctx[i]),
+                                      B = matrix_3x4(y, ctx[i+1]);
+                skcms_Matrix3x4 BA;
+                for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 4; c++) {
+                    BA.vals[r][c] = B.vals[r][0] * A.vals[0][c]
+                                  + B.vals[r][1] * A.vals[1][c]
+                                  + B.vals[r][2] * A.vals[2][c]
+                                  + (c == 3 ? B.vals[r][3] : 0.0f);
+                }
+                changed = set_matrix(i+1, BA);
+                if (changed) {
+                    erase(i);
+                }
+            } else if (x == Op::swap_rb && is_matrix(y)) {
+                // Swapping r and b into a matrix swaps its first and last columns.
+                skcms_Matrix3x4 m = matrix_3x4(y, ctx[i+1]);
+                for (int r = 0; r < 3; r++) {
+                    const float t = m.vals[r][0];
+                    m.vals[r][0] = m.vals[r][2];
+                    m.vals[r][2] = t;
+                }
+                changed = set_matrix(i+1, m);
+                if (changed) {
+                    erase(i);
                 }
+            } else if ((x == Op::clamp   && commutes_with_clamp(rgb_curve(y, ctx[i+1]))) ||
+                       (x == Op::swap_rb && commutes_with_swap_rb(y))) {
+                swap_ops(i);
+            } else {
+                changed = false;
             }
+        }
 
-            if (dstProfile->pcs == skcms_Signature_Lab) {
-                add_op(Op::xyz_to_lab);
+        // A second force_opaque is a no-op if nothing since the first has touched alpha.
+        for (ptrdiff_t i = 2; i + 1 < n && !changed; i++) {
+            if (ops[i] != Op::force_opaque) {
+                continue;
             }
-
-            if (dstProfile->B2A.input_channels == 3) {
-                if (!add_curve_ops(dstProfile->B2A.input_curves, /*numChannels=*/3)) {
-                    return false;
-                }
+            ptrdiff_t j = i - 1;
+            while (j > 0 && keeps_opaque(ops[j])) {
+                j--;
             }
+            if (j > 0 && ops[j] == Op::force_opaque) {
+                erase(i);
+                changed = true;
+            }
+        }
 
-            if (dstProfile->B2A.matrix_channels == 3) {
-                static const skcms_Matrix3x4 I = {{
-                    {1,0,0,0},
-                    {0,1,0,0},
-                    {0,0,1,0},
-                }};
-                if (0 != memcmp(&I, &dstProfile->B2A.matrix, sizeof(I))) {
-                    add_op_ctx(Op::matrix_3x4, &dstProfile->B2A.matrix);
+        // A swap_rb that can't move any later might still fold into an earlier matrix's rows.
+        for (ptrdiff_t i = 2; i + 1 < n && !changed; i++) {
+            if (ops[i] != Op::swap_rb) {
+                continue;
+            }
+            ptrdiff_t j = i - 1;
+            while (j > 0 && commutes_with_swap_rb(ops[j])) {
+                j--;
+            }
+            if (j > 0 && is_matrix(ops[j])) {
+                skcms_Matrix3x4 m = matrix_3x4(ops[j], ctx[j]);
+                for (int c = 0; c < 4; c++) {
+                    const float t = m.vals[0][c];
+                    m.vals[0][c] = m.vals[2][c];
+                    m.vals[2][c] = t;
                 }
-
-                if (!add_curve_ops(dstProfile->B2A.matrix_curves, /*numChannels=*/3)) {
-                    return false;
+                if (set_matrix(j, m)) {
+                    erase(i);
+                    changed = true;
                 }
             }
+        }
+    }
 
-            if (dstProfile->B2A.output_channels) {
-                add_op(Op::clamp);
-                add_op_ctx(Op::clut_B2A, &dstProfile->B2A);
+    xform->program_size = n;
+    if (gOptimizerHook) {
+        gOptimizerHook(gOptimizerHookCtx, (int)before, (int)n);
+    }
+}
 
-                if (!add_curve_ops(dstProfile->B2A.output_curves,
-                              (int)dstProfile->B2A.output_channels)) {
-                    return false;
-                }
+// Give each table op its context.  Curves short enough to keep in registers with xform's
+// backend become table_small_* ops: 32 entries in two AVX-512 registers, otherwise 16 in two
+// AVX2 registers.  (Backends without permutes still gather, but skip decoding each entry.)
+// The rest, and all of them without TransformExtras to hold small tables, read their curve
+// through a TableLUT, until decode_tables() fills in its floats.
+static void select_table_ops(skcms_CompiledTransform* xform) {
+    static const struct { Op table, small; } kOps[] = {
+        { Op::table_r, Op::table_small_r },
+        { Op::table_g, Op::table_small_g },
+        { Op::table_b, Op::table_small_b },
+        { Op::table_a, Op::table_small_a },
+    };
+    const uint32_t max_entries = xform->cpu == CpuType::SKX ? kMaxSmallTableEntries : 16;
+
+    TransformExtras* extras = xform->extras;
+    if (extras) {
+        extras->small_table_count = 0;
+    }
+    xform->table_lut_count = 0;
+    for (ptrdiff_t i = 0; i < xform->program_size; i++) {
+        for (auto op : kOps) {
+            if (xform->program[i] != op.table) {
+                continue;
             }
-        } else {
-            // This is a TRC destination.
+            const skcms_Curve* curve = (const skcms_Curve*)xform->contexts[i];
+            if (!extras || curve->table_entries > max_entries ||
+                extras->small_table_count == ARRAY_COUNT(extras->small_tables)) {
+                assert(xform->table_lut_count < ARRAY_COUNT(xform->table_luts));
+                TableLUT* lut = &xform->table_luts[xform->table_lut_count++];
+                lut->curve = curve;
+                lut->pairs = nullptr;
+                xform->contexts[i] = lut;
+                continue;
+            }
+            const int n = (int)curve->table_entries;
+            SmallTable* table = &extras->small_tables[extras->small_table_count++];
+            table->scale = (float)(n - 1);
+            for (int k = 0; k < kMaxSmallTableEntries; k++) {
+                const int e = k < n ? k : n-1;
+                table->vals[k] = curve->table_8
+                               ? curve->table_8[e] * (1/255.0f)
+                               : read_big_u16(curve->table_16 + 2*e) * (1/65535.0f);
+            }
+            xform->program [i] = op.small;
+            xform->contexts[i] = table;
+        }
+    }
+}
 
-            // Transform to the destination gamut.
-            if (src_using_hlg_ootf != dst_using_hlg_ootf) {
-                // If just the src or the dst has an HLG OOTF then we will apply the OOTF in XYZD50
-                // space. If both the src and dst has an HLG OOTF then they will cancel.
-                if (!src_using_A2B) {
-                    add_op_ctx(Op::matrix_3x3, &srcProfile->toXYZD50);
+// Tables longer than this stay undecoded, read from their curve as we go.
+static constexpr uint32_t kMaxDecodedTableEntries = 1 << 16;
+
+// Decode the tables behind xform's TableLUTs into native floats, each entry paired with the step
+// to the next, so that table_* finds both ends of its lerp with a single 64-bit load.  This costs
+// about as much as running a few thousand pixels, so we only do it for transforms we'll reuse or
+// that are large.  Failing to allocate just leaves the tables undecoded.
+static void decode_tables(skcms_CompiledTransform* xform) {
+    size_t total = 0;
+    for (int i = 0; i < xform->table_lut_count; i++) {
+        const uint32_t n = xform->table_luts[i].curve->table_entries;
+        total += n <= kMaxDecodedTableEntries ? 2 * (size_t)n : 0;
+    }
+    TransformExtras* extras = xform->extras;
+    if (total == 0 || !(extras->decoded_tables = (float*)malloc(total * sizeof(float)))) {
+        return;
+    }
+
+    float* pairs = extras->decoded_tables;
+    for (int i = 0; i < xform->table_lut_count; i++) {
+        TableLUT* lut = &xform->table_luts[i];
+        const skcms_Curve* curve = lut->curve;
+        const int n = (int)curve->table_entries;
+        if (curve->table_entries > kMaxDecodedTableEntries) {
+            continue;
+        }
+        auto entry = [curve](int k) {
+            return curve->table_8 ? curve->table_8[k] * (1/255.0f)
+                                  : read_big_u16(curve->table_16 + 2*k) * (1/65535.0f);
+        };
+        for (int k = 0; k < n; k++) {
+            pairs[2*k+0] = entry(k);
+            pairs[2*k+1] = k+1 < n ? entry(k+1) - entry(k) : 0.0f;
+        }
+        lut->pairs = pairs;
+        pairs += 2*n;
+    }
+}
+
+// Copy the grids behind xform's CLUTs into native-endian entries padded to 4 channels, for
+// skcms_CLUTLayout_Packed, also tiling them into Z-ordered blocks if blocked, for
+// skcms_CLUTLayout_Blocked.  Failing to allocate just leaves them where they are.
+static void pack_cluts(skcms_CompiledTransform* xform, bool blocked) {
+    const uint32_t kBlock = 1u << kCLUTBlockBits;
+
+    // Blocking pads each dimension up to whole blocks, and needs the padded grid's entries
+    // to stay indexable by I32; set up block_strides and return its entry count if so.
+    auto block = [&](CLUT& clut) -> uint64_t {
+        const int dim = (int)clut.input_channels;
+        uint64_t stride = 1u << (kCLUTBlockBits * dim);
+        for (int i = dim-1; i >= 0; i--) {
+            if (stride > INT_MAX) {
+                return 0;
+            }
+            clut.block_strides[i] = (int)stride;
+            stride *= (clut.grid_points[i] + kBlock - 1) / kBlock;
+        }
+        if (stride > INT_MAX) {
+            return 0;
+        }
+        clut.blocked = true;
+        return stride;
+    };
+    auto grid_entries = [](const CLUT& clut) {
+        uint64_t entries = 1;
+        for (uint32_t i = 0; i < clut.input_channels; i++) {
+            entries *= clut.grid_points[i];
+        }
+        return entries;
+    };
+    auto entry_bytes = [](const CLUT& clut) { return clut.grid_8 ? 4 : 8; };
+
+    uint64_t total = 0,
+             slots[ARRAY_COUNT(xform->cluts)];
+    for (int i = 0; i < xform->clut_count; i++) {
+        CLUT& clut = xform->cluts[i];
+        slots[i] = blocked ? block(clut) : 0;
+        if (slots[i] == 0) {
+            slots[i] = grid_entries(clut);
+        }
+        total += slots[i] * (uint64_t)entry_bytes(clut);
+    }
+    if (total == 0 || total > SIZE_MAX ||
+        !(xform->extras->packed_grids = (uint8_t*)calloc(1, (size_t)total))) {
+        for (int i = 0; i < xform->clut_count; i++) {
+            xform->cluts[i].blocked = false;
+        }
+        return;
+    }
+
+    uint8_t* cursor = xform->extras->packed_grids;
+    for (int i = 0; i < xform->clut_count; i++) {
+        CLUT& clut = xform->cluts[i];
+        const int      dim      = (int)clut.input_channels;
+        const uint64_t entries  = grid_entries(clut);
+        const uint32_t channels = clut.output_channels;
+
+        // Walk the ICC grid in order, tracking each entry's coordinates to find where it goes.
+        uint32_t coord[4] = {0,0,0,0};
+        for (uint64_t e = 0; e < entries; e++) {
+            uint64_t slot = e;
+            if (clut.blocked) {
+                slot = 0;
+                for (int d = 0; d < dim; d++) {
+                    slot += (uint64_t)(coord[d] >> kCLUTBlockBits)
+                          * (uint64_t)clut.block_strides[d];
+                    for (int l = 0; l < kCLUTBlockBits; l++) {
+                        slot += (uint64_t)((coord[d] >> l) & 1) << (l*dim + dim-1-d);
+                    }
                 }
-                if (src_using_hlg_ootf) {
-                    add_op(Op::hlg_ootf_scale);
+                for (int d = dim-1; d >= 0 && ++coord[d] == clut.grid_points[d]; d--) {
+                    coord[d] = 0;
                 }
-                if (dst_using_hlg_ootf) {
-                    add_op(Op::hlginv_ootf_scale);
+            }
+
+            if (clut.grid_8) {
+                uint8_t entry[4] = {0,0,0,0};
+                memcpy(entry, clut.grid_8 + e*channels, channels);
+                memcpy(cursor + 4*slot, entry, sizeof(entry));
+            } else {
+                uint16_t entry[4] = {0,0,0,0};
+                for (uint32_t c = 0; c < channels; c++) {
+                    entry[c] = read_big_u16(clut.grid_16 + 2*(e*channels + c));
                 }
-                add_op_ctx(Op::matrix_3x3, &dst_from_xyz);
-            } else if (src_using_A2B) {
+                memcpy(cursor + 8*slot, entry, sizeof(entry));
+            }
+        }
+        clut.packed = cursor;
+        cursor += slots[i] * (uint64_t)entry_bytes(clut);
+    }
+}
+
+// Replace common sequences of ops in xform's program with fused ops running them as one stage,
+// saving a dispatch and a round trip of r,g,b,a through the stage calling convention for each
+// op fused away.  Each fused op takes over the contexts of the ops it replaces, so contexts is
+// shared unchanged.  We match right to left so a store claims the curve before it first.
+static void fuse_program(skcms_CompiledTransform* xform) {
+    static const struct {
+        Op fused;
+        Op ops[3];
+        int count;
+    } kPatterns[] = {
+        { Op::tf_rgb_clamp_store_8888, { Op::tf_rgb, Op::clamp, Op::store_8888 }, 3 },
+        { Op::premul_store_8888,       { Op::premul, Op::store_8888            }, 2 },
+        { Op::matrix_3x3_tf_rgb,       { Op::matrix_3x3, Op::tf_rgb            }, 2 },
+        { Op::load_8888_tf_rgb,        { Op::load_8888, Op::tf_rgb             }, 2 },
+    };
+
+    const Op*       ops = xform->program;
+    Op*             out = xform->fused_program + ARRAY_COUNT(xform->fused_program);
+    ptrdiff_t       end = xform->program_size;
+    while (end > 0) {
+        int matched = 1;
+        Op  op      = ops[end-1];
+        for (const auto& p : kPatterns) {
+            if (!kProfiling && p.count <= end
+                    && 0 == memcmp(ops + end - p.count, p.ops, (size_t)p.count * sizeof(Op))) {
+                matched = p.count;
+                op      = p.fused;
+                break;
+            }
+        }
+        *--out = op;
+        end -= matched;
+    }
+
+    xform->fused_program_size = xform->fused_program + ARRAY_COUNT(xform->fused_program) - out;
+    memmove(xform->fused_program, out, (size_t)xform->fused_program_size * sizeof(Op));
+}
+
+// Build the program for this transform into xform, to run with backend cpu.  srcProfile and
+// dstProfile must not be null, and must outlive xform; its contexts may point into them.  With a
+// BakedLUT, that single lookup stands in for the whole conversion from srcProfile to dstProfile.
+// xform keeps extras, if any, to hold contexts and later its fast paths; they stay the caller's
+// to free if compiling fails.
+static bool compile_transform(skcms_CompiledTransform* xform,
+                              skcms_PixelFormat       srcFmt,
+                              skcms_AlphaFormat       srcAlpha,
+                              const skcms_ICCProfile* srcProfile,
+                              skcms_PixelFormat       dstFmt,
+                              skcms_AlphaFormat       dstAlpha,
+                              const skcms_ICCProfile* dstProfile,
+                              const BakedLUT*         baked = nullptr,
+                              skcms_Interpolation     interpolation
+                                                          = skcms_Interpolation_Multilinear,
+                              CpuType                 cpu = current_backend(),
+                              TransformExtras*        extras = nullptr) {
+    xform->cpu        = cpu;
+    xform->dst_bpp    = bytes_per_pixel(dstFmt);
+    xform->src_bpp    = bytes_per_pixel(srcFmt);
+    xform->clut_count = 0;
+    xform->extras     = extras;
+
+    Op*          ops      = xform->program;
+    const void** contexts = xform->contexts;
+
+    auto add_op = [&](Op o) {
+        *ops++ = o;
+        *contexts++ = nullptr;
+    };
+
+    auto add_op_ctx = [&](Op o, const void* c) {
+        *ops++ = o;
+        *contexts++ = c;
+    };
+
+    const bool simplex = (interpolation == skcms_Interpolation_Simplex);
+
+    auto add_clut_op = [&](Op o, uint32_t input_channels, uint32_t output_channels,
+                           const uint8_t* grid_points,
+                           const uint8_t* grid_8, const uint8_t* grid_16) {
+        assert(xform->clut_count < ARRAY_COUNT(xform->cluts));
+        CLUT* clut = &xform->cluts[xform->clut_count++];
+        *clut = { input_channels, output_channels, grid_points, grid_8, grid_16,
+                  nullptr, false, {0,0,0,0} };
+        add_op_ctx(o, clut);
+    };
+
+    auto add_curve_ops = [&](const skcms_Curve* curves, int numChannels) -> bool {
+        OpAndArg oa[4];
+        assert(numChannels <= ARRAY_COUNT(oa));
+
+        int numOps = select_curve_ops(curves, numChannels, oa);
+        if (numOps < 0) {
+            return false;
+        }
+
+        for (int i = 0; i < numOps; ++i) {
+            add_op_ctx(oa[i].op, oa[i].arg);
+        }
+        return true;
+    };
+
+    skcms_TransferFunction& src_cicp_trc = xform->src_cicp_trc;
+    skcms_Curve*            dst_curves   = xform->dst_curves;
+    skcms_Matrix3x3&        dst_from_xyz = xform->dst_from_xyz;
+    skcms_Matrix3x3&        dst_from_src = xform->dst_from_src;
+
+    dst_curves[0].table_entries =
+    dst_curves[1].table_entries =
+    dst_curves[2].table_entries = 0;
+
+    switch (srcFmt >> 1) {
+        default: return false;
+        case skcms_PixelFormat_A_8              >> 1: add_op(Op::load_a8);          break;
+        case skcms_PixelFormat_G_8              >> 1: add_op(Op::load_g8);          break;
+        case skcms_PixelFormat_GA_88            >> 1: add_op(Op::load_ga88);        break;
+        case skcms_PixelFormat_ABGR_4444        >> 1: add_op(Op::load_4444);        break;
+        case skcms_PixelFormat_RGB_565          >> 1: add_op(Op::load_565);         break;
+        case skcms_PixelFormat_RGB_888          >> 1: add_op(Op::load_888);         break;
+        case skcms_PixelFormat_RGBA_8888        >> 1: add_op(Op::load_8888);        break;
+        case skcms_PixelFormat_RGBA_1010102     >> 1: add_op(Op::load_1010102);     break;
+        case skcms_PixelFormat_RGB_101010x_XR   >> 1: add_op(Op::load_101010x_XR);  break;
+        case skcms_PixelFormat_RGBA_10101010_XR >> 1: add_op(Op::load_10101010_XR); break;
+        case skcms_PixelFormat_RGB_161616LE     >> 1: add_op(Op::load_161616LE);    break;
+        case skcms_PixelFormat_RGBA_16161616LE  >> 1: add_op(Op::load_16161616LE);  break;
+        case skcms_PixelFormat_RGB_161616BE     >> 1: add_op(Op::load_161616BE);    break;
+        case skcms_PixelFormat_RGBA_16161616BE  >> 1: add_op(Op::load_16161616BE);  break;
+        case skcms_PixelFormat_RGB_hhh_Norm     >> 1: add_op(Op::load_hhh);         break;
+        case skcms_PixelFormat_RGBA_hhhh_Norm   >> 1: add_op(Op::load_hhhh);        break;
+        case skcms_PixelFormat_RGB_hhh          >> 1: add_op(Op::load_hhh);         break;
+        case skcms_PixelFormat_RGBA_hhhh        >> 1: add_op(Op::load_hhhh);        break;
+        case skcms_PixelFormat_RGB_fff          >> 1: add_op(Op::load_fff);         break;
+        case skcms_PixelFormat_RGBA_ffff        >> 1: add_op(Op::load_ffff);        break;
+
+        case skcms_PixelFormat_RGB_888_Planar >> 1:
+            add_op(Op::load_planar_888);
+            break;
+        case skcms_PixelFormat_RGBA_8888_Planar >> 1:
+            add_op(Op::load_planar_8888);
+            break;
+        case skcms_PixelFormat_RGB_161616LE_Planar >> 1:
+            add_op(Op::load_planar_161616);
+            break;
+        case skcms_PixelFormat_RGBA_16161616LE_Planar >> 1:
+            add_op(Op::load_planar_16161616);
+            break;
+        case skcms_PixelFormat_RGB_hhh_Planar >> 1:
+            add_op(Op::load_planar_hhh);
+            break;
+        case skcms_PixelFormat_RGBA_hhhh_Planar >> 1:
+            add_op(Op::load_planar_hhhh);
+            break;
+        case skcms_PixelFormat_RGB_fff_Planar >> 1:
+            add_op(Op::load_planar_fff);
+            break;
+        case skcms_PixelFormat_RGBA_ffff_Planar >> 1:
+            add_op(Op::load_planar_ffff);
+            break;
+
+        case skcms_PixelFormat_YCbCr_444_888    >> 1: add_op(Op::load_planar_888);       break;
+        case skcms_PixelFormat_YCbCr_444_161616 >> 1: add_op(Op::load_planar_161616);    break;
+        case skcms_PixelFormat_YCbCr_422_888    >> 1: add_op(Op::load_ycbcr_h2_888);     break;
+        case skcms_PixelFormat_YCbCr_420_888    >> 1: add_op(Op::load_ycbcr_h2_888);     break;
+        case skcms_PixelFormat_YCbCr_420_88     >> 1: add_op(Op::load_ycbcr_h2_semi_8);  break;
+        case skcms_PixelFormat_YCbCr_420_1616   >> 1: add_op(Op::load_ycbcr_h2_semi_16); break;
+
+        case skcms_PixelFormat_RGBA_8888_sRGB >> 1:
+            add_op(Op::load_8888);
+            add_op_ctx(Op::tf_rgb, skcms_sRGB_TransferFunction());
+            break;
+    }
+    if (srcFmt == skcms_PixelFormat_RGB_hhh_Norm ||
+        srcFmt == skcms_PixelFormat_RGBA_hhhh_Norm) {
+        add_op(Op::clamp);
+    }
+    if (is_ycbcr(srcFmt)) {
+        // Convert to R'G'B' right away, ready for the source profile's transfer function.
+        if (srcProfile->data_color_space != skcms_Signature_RGB ||
+                !ycbcr_to_rgb_matrix(srcProfile, srcFmt, &xform->ycbcr_to_rgb)) {
+            return false;
+        }
+        add_op_ctx(Op::matrix_3x4, &xform->ycbcr_to_rgb);
+        add_op(Op::clamp);
+    } else if (srcFmt & 1) {
+        add_op(Op::swap_rb);
+    }
+    switch (dstFmt >> 1) {
+        case skcms_PixelFormat_G_8:
+        case skcms_PixelFormat_GA_88:
+            // When transforming to gray, stop at XYZ (by setting toXYZ to identity), then transform
+            // luminance (Y) by the destination transfer function.
+            xform->gray_dst_profile = *dstProfile;
+            skcms_SetXYZD50(&xform->gray_dst_profile, &skcms_XYZD50_profile()->toXYZD50);
+            dstProfile = &xform->gray_dst_profile;
+            break;
+        default:
+            break;
+    }
+
+    if (srcProfile->data_color_space == skcms_Signature_CMYK) {
+        // Photoshop creates CMYK images as inverse CMYK.
+        // These happen to be the only ones we've _ever_ seen.
+        add_op(Op::invert);
+        // With CMYK, ignore the alpha type, to avoid changing K or conflating CMY with K.
+        srcAlpha = skcms_AlphaFormat_Unpremul;
+    }
+
+    if (srcAlpha == skcms_AlphaFormat_Opaque) {
+        add_op(Op::force_opaque);
+    } else if (srcAlpha == skcms_AlphaFormat_PremulAsEncoded) {
+        add_op(Op::unpremul);
+    }
+
+    if (baked) {
+        add_op_ctx(Op::baked_lut, baked);
+    } else if (dstProfile != srcProfile) {
+
+        // Track whether or not the A2B or B2A transforms are used. the CICP
+        // values take precedence over A2B and B2A.
+        bool src_using_A2B = false;
+        bool src_using_hlg_ootf = false;
+        bool dst_using_B2A = false;
+        bool dst_using_hlg_ootf = false;
+
+        if (!prep_for_destination(dstProfile,
+                                  &dst_from_xyz,
+                                  &dst_curves[0].parametric,
+                                  &dst_curves[1].parametric,
+                                  &dst_curves[2].parametric,
+                                  &dst_using_B2A,
+                                  &dst_using_hlg_ootf)) {
+            return false;
+        }
+
+        if (has_cicp_pq_trc(srcProfile) && srcProfile->has_toXYZD50) {
+            set_reference_pq_ish_trc(&src_cicp_trc);
+            add_op_ctx(Op::pq_rgb, &src_cicp_trc);
+        } else if (has_cicp_hlg_trc(srcProfile) && srcProfile->has_toXYZD50) {
+            src_using_hlg_ootf = true;
+            set_sdr_hlg_ish_trc(&src_cicp_trc);
+            add_op_ctx(Op::hlg_rgb, &src_cicp_trc);
+        } else if (srcProfile->has_A2B) {
+            src_using_A2B = true;
+            if (srcProfile->A2B.input_channels) {
+                if (!add_curve_ops(srcProfile->A2B.input_curves,
+                              (int)srcProfile->A2B.input_channels)) {
+                    return false;
+                }
+                add_op(Op::clamp);
+                const skcms_A2B& a2b = srcProfile->A2B;
+                add_clut_op(simplex ? Op::clut_A2B_simplex : Op::clut_A2B,
+                            a2b.input_channels, a2b.output_channels,
+                            a2b.grid_points, a2b.grid_8, a2b.grid_16);
+            }
+
+            if (srcProfile->A2B.matrix_channels == 3) {
+                if (!add_curve_ops(srcProfile->A2B.matrix_curves, /*numChannels=*/3)) {
+                    return false;
+                }
+
+                static const skcms_Matrix3x4 I = {{
+                    {1,0,0,0},
+                    {0,1,0,0},
+                    {0,0,1,0},
+                }};
+                if (0 != memcmp(&I, &srcProfile->A2B.matrix, sizeof(I))) {
+                    add_op_ctx(Op::matrix_3x4, &srcProfile->A2B.matrix);
+                }
+            }
+
+            if (srcProfile->A2B.output_channels == 3) {
+                if (!add_curve_ops(srcProfile->A2B.output_curves, /*numChannels=*/3)) {
+                    return false;
+                }
+            }
+
+            if (srcProfile->pcs == skcms_Signature_Lab) {
+                add_op(Op::lab_to_xyz);
+            }
+
+        } else if (srcProfile->has_trc && srcProfile->has_toXYZD50) {
+            if (!add_curve_ops(srcProfile->trc, /*numChannels=*/3)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+
+        // A2B sources are in XYZD50 by now, but TRC sources are still in their original gamut.
+        assert (srcProfile->has_A2B || srcProfile->has_toXYZD50);
+
+        if (dst_using_B2A) {
+            // B2A needs its input in XYZD50, so transform TRC sources now.
+            if (!src_using_A2B) {
+                add_op_ctx(Op::matrix_3x3, &srcProfile->toXYZD50);
+                // Apply the HLG OOTF in XYZD50 space, if needed.
+                if (src_using_hlg_ootf) {
+                    add_op(Op::hlg_ootf_scale);
+                }
+            }
+
+            if (dstProfile->pcs == skcms_Signature_Lab) {
+                add_op(Op::xyz_to_lab);
+            }
+
+            if (dstProfile->B2A.input_channels == 3) {
+                if (!add_curve_ops(dstProfile->B2A.input_curves, /*numChannels=*/3)) {
+                    return false;
+                }
+            }
+
+            if (dstProfile->B2A.matrix_channels == 3) {
+                static const skcms_Matrix3x4 I = {{
+                    {1,0,0,0},
+                    {0,1,0,0},
+                    {0,0,1,0},
+                }};
+                if (0 != memcmp(&I, &dstProfile->B2A.matrix, sizeof(I))) {
+                    add_op_ctx(Op::matrix_3x4, &dstProfile->B2A.matrix);
+                }
+
+                if (!add_curve_ops(dstProfile->B2A.matrix_curves, /*numChannels=*/3)) {
+                    return false;
+                }
+            }
+
+            if (dstProfile->B2A.output_channels) {
+                add_op(Op::clamp);
+                const skcms_B2A& b2a = dstProfile->B2A;
+                add_clut_op(simplex ? Op::clut_B2A_simplex : Op::clut_B2A,
+                            b2a.input_channels, b2a.output_channels,
+                            b2a.grid_points, b2a.grid_8, b2a.grid_16);
+
+                if (!add_curve_ops(dstProfile->B2A.output_curves,
+                              (int)dstProfile->B2A.output_channels)) {
+                    return false;
+                }
+            }
+        } else {
+            // This is a TRC destination.
+
+            // Transform to the destination gamut.
+            if (src_using_hlg_ootf != dst_using_hlg_ootf) {
+                // If just the src or the dst has an HLG OOTF then we will apply the OOTF in XYZD50
+                // space. If both the src and dst has an HLG OOTF then they will cancel.
+                if (!src_using_A2B) {
+                    add_op_ctx(Op::matrix_3x3, &srcProfile->toXYZD50);
+                }
+                if (src_using_hlg_ootf) {
+                    add_op(Op::hlg_ootf_scale);
+                }
+                if (dst_using_hlg_ootf) {
+                    add_op(Op::hlginv_ootf_scale);
+                }
+                add_op_ctx(Op::matrix_3x3, &dst_from_xyz);
+            } else if (src_using_A2B) {
                 // If the source is A2B then we are already in XYZD50. Just apply the xyz->dst
                 // matrix.
                 add_op_ctx(Op::matrix_3x3, &dst_from_xyz);
@@ -3063,7 +4342,8 @@ bool skcms_Transform(const void*             src,
     //
     // E.g. r = 1.1, a = 0.5 would fit fine in fixed point after premul (ra=0.55,a=0.5),
     // but would be carrying r > 1, which is really unexpected for downstream consumers.
-    if (dstFmt < skcms_PixelFormat_RGB_hhh) {
+    if (dstFmt < skcms_PixelFormat_RGB_hhh ||
+        (dstFmt >= skcms_PixelFormat_RGB_888_Planar && dstFmt < skcms_PixelFormat_RGB_hhh_Planar)) {
         add_op(Op::clamp);
     }
 
@@ -3107,37 +4387,1478 @@ bool skcms_Transform(const void*             src,
         case skcms_PixelFormat_RGB_fff          >> 1: add_op(Op::store_fff);         break;
         case skcms_PixelFormat_RGBA_ffff        >> 1: add_op(Op::store_ffff);        break;
 
-        case skcms_PixelFormat_RGBA_8888_sRGB >> 1:
-            add_op_ctx(Op::tf_rgb, skcms_sRGB_Inverse_TransferFunction());
-            add_op(Op::store_8888);
+        case skcms_PixelFormat_RGB_888_Planar >> 1:
+            add_op(Op::store_planar_888);
+            break;
+        case skcms_PixelFormat_RGBA_8888_Planar >> 1:
+            add_op(Op::store_planar_8888);
+            break;
+        case skcms_PixelFormat_RGB_161616LE_Planar >> 1:
+            add_op(Op::store_planar_161616);
+            break;
+        case skcms_PixelFormat_RGBA_16161616LE_Planar >> 1:
+            add_op(Op::store_planar_16161616);
+            break;
+        case skcms_PixelFormat_RGB_hhh_Planar >> 1:
+            add_op(Op::store_planar_hhh);
+            break;
+        case skcms_PixelFormat_RGBA_hhhh_Planar >> 1:
+            add_op(Op::store_planar_hhhh);
+            break;
+        case skcms_PixelFormat_RGB_fff_Planar >> 1:
+            add_op(Op::store_planar_fff);
+            break;
+        case skcms_PixelFormat_RGBA_ffff_Planar >> 1:
+            add_op(Op::store_planar_ffff);
             break;
-    }
-
-    assert(ops      <= program + ARRAY_COUNT(program));
-    assert(contexts <= context + ARRAY_COUNT(context));
 
-    auto run = baseline::run_program;
-    switch (cpu_type()) {
+        case skcms_PixelFormat_RGBA_8888_sRGB >> 1:
+            add_op_ctx(Op::tf_rgb, skcms_sRGB_Inverse_TransferFunction());
+            add_op(Op::store_8888);
+            break;
+    }
+
+    assert(ops      <= xform->program  + ARRAY_COUNT(xform->program));
+    assert(contexts <= xform->contexts + ARRAY_COUNT(xform->contexts));
+
+    xform->program_size = ops - xform->program;
+    optimize_program(xform);
+    select_table_ops(xform);
+    fuse_program(xform);
+    xform->run    = select_backend(xform->cpu);
+    xform->kernel = kProfiling ? nullptr
+                               : select_kernel(xform->cpu, xform->program, xform->program_size);
+
+    xform->src_layout = planar_layout(xform->program[0]);
+    xform->dst_layout = planar_layout(xform->program[xform->program_size-1]);
+    xform->src_chroma_vshift = (srcFmt >> 1) == (skcms_PixelFormat_YCbCr_420_888  >> 1)
+                            || (srcFmt >> 1) == (skcms_PixelFormat_YCbCr_420_88   >> 1)
+                            || (srcFmt >> 1) == (skcms_PixelFormat_YCbCr_420_1616 >> 1) ? 1 : 0;
+    return true;
+}
+
+// Pixel start of interleaved pixels, or for planar formats, a skcms_PlanarBuffer in *storage
+// pointing at pixel start (or its chroma sample) in each plane.
+static const void* offset_pixels(const void* pixels, const PlanarLayout& layout, size_t bpp,
+                                 size_t start, skcms_PlanarBuffer* storage) {
+    if (layout.planes == 0) {
+        return (const char*)pixels + start * bpp;
+    }
+    const skcms_PlanarBuffer* buffer = (const skcms_PlanarBuffer*)pixels;
+    for (int p = 0; p < layout.planes; p++) {
+        storage->planes[p] = (char*)buffer->planes[p] + (start >> layout.shift[p]) * layout.bytes[p];
+    }
+    return storage;
+}
+
+// The most bytes from one pixel to the next in any plane.
+static size_t max_step(const PlanarLayout& layout, size_t bpp) {
+    size_t step = layout.planes ? 0 : bpp;
+    for (int p = 0; p < layout.planes; p++) {
+        step = layout.bytes[p] > step ? layout.bytes[p] : step;
+    }
+    return step;
+}
+
+// run_program() counts pixels with an int, and its stages find each pixel at an int offset, so
+// we feed it the span in pieces small enough that no offset into src or dst exceeds INT_MAX.
+// Every piece but the last is a multiple of 16 pixels, so only that last piece has a tail, and
+// subsampled planes always start a piece at a whole sample.
+static void run_span(const skcms_CompiledTransform* xform,
+                     const void* src, void* dst, size_t start, size_t npixels) {
+    const TransformExtras* extras = xform->extras;
+    if (extras && extras->use_byte_luts) {
+        // Byte LUTs, like lowp programs below, only handle interleaved 8-bit formats, and count
+        // pixels with an int.
+        const size_t piece = (size_t)INT_MAX / 4;
+        while (npixels > 0) {
+            const size_t n = npixels < piece ? npixels : piece;
+            extras->run_byte_luts(extras->byte_luts,
+                                  (const char*)src + start * xform->src_bpp,
+                                  (char*)dst       + start * xform->dst_bpp,
+                                  (int)n, xform->src_bpp, xform->dst_bpp);
+            start   += n;
+            npixels -= n;
+        }
+        return;
+    }
+    if (extras && extras->use_lowp) {
+        // Lowp programs only handle interleaved 8-bit formats, and count pixels with an int.
+        const size_t piece = (size_t)INT_MAX / 4;
+        while (npixels > 0) {
+            const size_t n = npixels < piece ? npixels : piece;
+            extras->run_lowp(extras->lowp_program, (const void**)extras->lowp_contexts,
+                             extras->lowp_program_size,
+                             (const char*)src + start * xform->src_bpp,
+                             (char*)dst       + start * xform->dst_bpp,
+                             (int)n, xform->src_bpp, xform->dst_bpp);
+            start   += n;
+            npixels -= n;
+        }
+        return;
+    }
+    if (extras && extras->jit.code) {
+        // JIT programs only handle interleaved formats.
+        jit::run(extras->jit, (const char*)src + start * xform->src_bpp,
+                             (char*)dst       + start * xform->dst_bpp,
+                 npixels, xform->src_bpp, xform->dst_bpp);
+        return;
+    }
+    const size_t src_step = max_step(xform->src_layout, xform->src_bpp),
+                 dst_step = max_step(xform->dst_layout, xform->dst_bpp),
+                 piece    = ((size_t)INT_MAX / (src_step > dst_step ? src_step : dst_step))
+                          & ~(size_t)15;
+    const RunProgramFn run = xform->kernel ? xform->kernel : xform->run;
+    while (npixels > 0) {
+        const size_t n = npixels < piece ? npixels : piece;
+        skcms_PlanarBuffer src_planes, dst_planes;
+        run(xform->fused_program, (const void**)xform->contexts, xform->fused_program_size,
+            (const char*)offset_pixels(src, xform->src_layout, xform->src_bpp, start,
+                                       &src_planes),
+            (char*)offset_pixels(dst, xform->dst_layout, xform->dst_bpp, start, &dst_planes),
+            (int)n, xform->src_bpp, xform->dst_bpp);
+        start   += n;
+        npixels -= n;
+    }
+}
+
+// The ops that transform each channel on its own, never reading or writing any other.
+static const Op kPerChannelOps[] = {
+    Op::swap_rb, Op::clamp, Op::invert, Op::force_opaque,
+    Op::gamma_r,   Op::gamma_g,   Op::gamma_b,   Op::gamma_rgb,
+    Op::tf_r,      Op::tf_g,      Op::tf_b,      Op::tf_rgb,
+    Op::pq_r,      Op::pq_g,      Op::pq_b,      Op::pq_rgb,
+    Op::hlg_r,     Op::hlg_g,     Op::hlg_b,     Op::hlg_rgb,
+    Op::hlginv_r,  Op::hlginv_g,  Op::hlginv_b,  Op::hlginv_rgb,
+    Op::table_r,   Op::table_g,   Op::table_b,
+    Op::table_small_r, Op::table_small_g, Op::table_small_b,
+};
+
+// If xform's program loads and stores 8-bit RGB(A) and only uses per-channel ops in between,
+// sample it once for every byte value and run it as per-channel lookups from then on.  Programs
+// without any curves just move, clamp, or invert bytes, which running them does faster.
+// Profiling builds never do this, so that each op is still timed.
+static void build_byte_luts(skcms_CompiledTransform* xform) {
+    const Op* program = xform->program;
+    const ptrdiff_t n  = xform->program_size;
+    if (kProfiling ||
+        (program[0]   != Op::load_888  && program[0]   != Op::load_8888) ||
+        (program[n-1] != Op::store_888 && program[n-1] != Op::store_8888)) {
+        return;
+    }
+    bool swapped = false,
+         curves  = false;
+    for (ptrdiff_t i = 1; i < n-1; i++) {
+        bool per_channel = false;
+        for (Op op : kPerChannelOps) {
+            per_channel = per_channel || program[i] == op;
+        }
+        if (!per_channel) {
+            return;
+        }
+        swapped ^= (program[i] == Op::swap_rb);
+        curves  |= program[i] != Op::swap_rb && program[i] != Op::clamp
+                && program[i] != Op::invert  && program[i] != Op::force_opaque;
+    }
+    if (!curves) {
+        return;
+    }
+
+    // Run the program over pixels whose channels all hold the same byte, v.  Each destination
+    // channel then holds the function of its source channel at v.
+    uint8_t src[256*4], dst[256*4];
+    for (int v = 0; v < 256; v++) {
+        memset(src + v * xform->src_bpp, v, xform->src_bpp);
+    }
+    run_span(xform, src, dst, 0, 256);
+
+    ByteLUTs* luts = &xform->extras->byte_luts;
+    for (int c = 0; c < 4; c++) {
+        luts->src_channel[c] = swapped && c != 1 && c != 3 ? 2 - c : c;
+        for (int v = 0; v < 256; v++) {
+            // Without a destination alpha, this is never read; without a source alpha, it's 1.
+            const uint8_t byte = dst[v * xform->dst_bpp + (c < (int)xform->dst_bpp ? c : 0)];
+            luts->bytes[c][v] = byte;
+            luts->table[c][v] = (uint32_t)byte << (8*c);
+        }
+    }
+    if (xform->src_bpp == 3) {
+        luts->src_channel[3] = 0;
+    }
+    xform->extras->run_byte_luts = select_byte_luts_backend(xform->cpu);
+    xform->extras->use_byte_luts = true;
+}
+
+// Sampling 256 pixels to build byte LUTs only pays off for transforms with many more pixels.
+static constexpr size_t kByteLUTMinPixels = 4096;
+
+// The float ops that lowp curves can stand in for: each maps [0,1] into [0,1] for the channels it
+// touches (r, g, b, or all three), leaving the others alone.
+static bool lowp_curve_channels(Op op, bool channels[3]) {
+    static const struct { Op op; int channel; } kCurveOps[] = {
+        {Op::gamma_r, 0}, {Op::gamma_g, 1}, {Op::gamma_b, 2}, {Op::gamma_rgb, -1},
+        {Op::tf_r,    0}, {Op::tf_g,    1}, {Op::tf_b,    2}, {Op::tf_rgb,    -1},
+        {Op::table_r, 0}, {Op::table_g, 1}, {Op::table_b, 2},
+        {Op::table_small_r, 0}, {Op::table_small_g, 1}, {Op::table_small_b, 2},
+    };
+    for (auto c : kCurveOps) {
+        if (c.op == op) {
+            for (int i = 0; i < 3; i++) {
+                channels[i] = channels[i] || c.channel < 0 || c.channel == i;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// If xform's program loads and stores 8-bit RGB(A) and everything in between has a lowp
+// equivalent, translate it into an equivalent lowp program.  Runs of curves are merged and
+// sampled into one table per channel by running them with the float backend.
+static void build_lowp(skcms_CompiledTransform* xform) {
+    const Op*          program  = xform->program;
+    const void* const* contexts = xform->contexts;
+    const ptrdiff_t    n        = xform->program_size;
+    const RunLowpFn    run_lowp = select_lowp_backend(xform->cpu);
+    if (!run_lowp ||
+        (program[0]   != Op::load_888  && program[0]   != Op::load_8888) ||
+        (program[n-1] != Op::store_888 && program[n-1] != Op::store_8888)) {
+        return;
+    }
+
+    // First make sure we can translate every op, and count how much storage we'll need.
+    int  matrices   = 0,
+         curves     = 0;
+    bool prev_curve = false;
+    for (ptrdiff_t i = 1; i < n-1; i++) {
+        bool channels[3] = {false, false, false};
+        const bool curve = lowp_curve_channels(program[i], channels);
+        curves    += curve && !prev_curve;
+        prev_curve = curve;
+        if (curve) {
+            continue;
+        }
+        switch (program[i]) {
+            case Op::matrix_3x3: {
+                const skcms_Matrix3x3* m = (const skcms_Matrix3x3*)contexts[i];
+                for (int r = 0; r < 3; r++) {
+                    float sum = 0;
+                    for (int c = 0; c < 3; c++) {
+                        sum += fabsf_(m->vals[r][c]);
+                    }
+                    if (!(sum < 15.99f)) {
+                        return;
+                    }
+                }
+                matrices++;
+            } break;
+
+            case Op::swap_rb:
+            case Op::clamp:
+            case Op::force_opaque:
+            case Op::premul:
+            case Op::unpremul:
+                break;
+
+            default:
+                return;
+        }
+    }
+
+    const size_t table_bytes = kLowpCurveEntries * sizeof(int32_t);
+    char*  storage = (char*)malloc((size_t)matrices * sizeof(LowpMatrix) +
+                                   (size_t)curves   * (sizeof(LowpCurves) + 3 * table_bytes));
+    float* samples = curves ? (float*)malloc((kLowpCurveEntries+1) * 3 * sizeof(float))
+                           : nullptr;
+    if ((matrices + curves > 0 && !storage) || (curves && !samples)) {
+        free(storage);
+        free(samples);
+        return;
+    }
+
+    // Lay out storage with all the LowpCurves first, then every LowpMatrix, then the tables.
+    TransformExtras* extras = xform->extras;
+    LowpOp*      ops        = extras->lowp_program;
+    const void** ctxs       = extras->lowp_contexts;
+    LowpCurves*  next_lc    = (LowpCurves*)storage;
+    LowpMatrix*  next_lm    = (LowpMatrix*)(next_lc + curves);
+    int32_t*     next_table = (int32_t*)(next_lm + matrices);
+    auto add_op = [&](LowpOp op, const void* ctx) {
+        *ops++  = op;
+        *ctxs++ = ctx;
+    };
+
+    add_op(program[0] == Op::load_888 ? LowpOp::load_888 : LowpOp::load_8888, nullptr);
+    for (ptrdiff_t i = 1; i < n-1; i++) {
+        bool channels[3] = {false, false, false};
+        if (lowp_curve_channels(program[i], channels)) {
+            ptrdiff_t end = i + 1;
+            while (end < n-1 && lowp_curve_channels(program[end], channels)) {
+                end++;
+            }
+
+            Op          sample_program [32];
+            const void* sample_contexts[32];
+            ptrdiff_t   sample_size = 0;
+            sample_program [sample_size] = Op::load_fff;
+            sample_contexts[sample_size] = nullptr;
+            for (ptrdiff_t j = i; j < end; j++) {
+                sample_size++;
+                sample_program [sample_size] = program [j];
+                sample_contexts[sample_size] = contexts[j];
+            }
+            sample_size++;
+            sample_program [sample_size] = Op::store_fff;
+            sample_contexts[sample_size] = nullptr;
+            sample_size++;
+
+            // Sample at each Q15 value lowp will look up, x = 8k/0x7fff.
+            for (int k = 0; k <= kLowpCurveEntries; k++) {
+                samples[3*k+0] = samples[3*k+1] = samples[3*k+2] = (float)(8*k) * (1/32767.0f);
+            }
+            xform->run(sample_program, sample_contexts, sample_size,
+                       (const char*)samples, (char*)samples, kLowpCurveEntries+1, 12, 12);
+            auto to_Q15 = [](float v) {
+                // Written so NaN clamps to 0.
+                v = v * 32767.0f + 0.5f;
+                v = v < 32767.0f ? v : 32767.0f;
+                v = v > 0        ? v : 0;
+                return (int32_t)v;
+            };
+
+            LowpCurves* lc = next_lc++;
+            for (int c = 0; c < 3; c++) {
+                lc->table[c] = nullptr;
+                if (channels[c]) {
+                    int32_t* table = next_table;
+                    next_table += kLowpCurveEntries;
+                    for (int k = 0; k < kLowpCurveEntries; k++) {
+                        const int32_t lo = to_Q15(samples[3*k    +c]),
+                                      hi = to_Q15(samples[3*k + 3+c]);
+                        table[k] = (int32_t)((uint32_t)lo | (uint32_t)(hi - lo) << 16);
+                    }
+                    lc->table[c] = table;
+                }
+            }
+            add_op(LowpOp::curves, lc);
+            i = end - 1;
+            continue;
+        }
+
+        switch (program[i]) {
+            case Op::matrix_3x3: {
+                const skcms_Matrix3x3* m = (const skcms_Matrix3x3*)contexts[i];
+                LowpMatrix* lm = next_lm++;
+                for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++) {
+                    float v = m->vals[r][c] * 4096.0f;
+                    lm->vals[r][c] = (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+                }
+                add_op(LowpOp::matrix_3x3, lm);
+            } break;
+
+            // Lowp values always stay within [0,1].
+            case Op::clamp: break;
+
+            case Op::swap_rb:      add_op(LowpOp::swap_rb,      nullptr); break;
+            case Op::force_opaque: add_op(LowpOp::force_opaque, nullptr); break;
+            case Op::premul:       add_op(LowpOp::premul,       nullptr); break;
+            case Op::unpremul:     add_op(LowpOp::unpremul,     nullptr); break;
+
+            default: assert(false); break;
+        }
+    }
+    add_op(program[n-1] == Op::store_888 ? LowpOp::store_888 : LowpOp::store_8888, nullptr);
+    free(samples);
+
+    extras->lowp_program_size = ops - extras->lowp_program;
+    extras->lowp_storage      = storage;
+    extras->run_lowp          = run_lowp;
+    extras->use_lowp          = true;
+}
+
+// Decoding tables and compiling machine code only pay off for transforms of many pixels.  Both
+// leave output unchanged, so skcms_Transform() can choose them by pixel count.
+static constexpr size_t kFastPathMinPixels = 64 * 1024;
+
+// Compile xform's float program to AVX2 machine code when we'd otherwise run it with
+// hsw::run_program(), and we can compile every op.  Its output matches hsw::run_program()
+// exactly.  As with lowp, AVX-512 float stages are faster still, so SKX keeps the interpreter.
+static void build_jit(skcms_CompiledTransform* xform) {
+    switch (xform->cpu) {
         case CpuType::SKX:
             #if !defined(SKCMS_DISABLE_SKX)
-                run = skx::run_program;
                 break;
             #endif
 
         case CpuType::HSW:
-            #if !defined(SKCMS_DISABLE_HSW)
-                run = hsw::run_program;
-                break;
-            #endif
+            // This fails harmlessly when we've not built the JIT, e.g. with SKCMS_DISABLE_HSW.
+            jit::compile(xform->program, (const void**)xform->contexts, xform->program_size,
+                         &xform->extras->jit);
+            break;
 
+        case CpuType::SSE41:
         case CpuType::Baseline:
             break;
     }
+}
+
+// Allocate TransformExtras with no fast paths yet, or return null.
+static TransformExtras* new_extras() {
+    auto extras = (TransformExtras*)malloc(sizeof(TransformExtras));
+    if (!extras) {
+        return nullptr;
+    }
+    extras->decoded_tables = nullptr;
+    extras->packed_grids   = nullptr;
+    extras->use_byte_luts  = false;
+    extras->use_lowp       = false;
+    extras->lowp_storage   = nullptr;
+    extras->jit.code       = nullptr;
+    extras->owned_tables   = nullptr;
+    return extras;
+}
+
+// Free extras, if any, and everything they hold.
+static void free_extras(TransformExtras* extras) {
+    if (extras) {
+        free(extras->decoded_tables);
+        free(extras->packed_grids);
+        free(extras->lowp_storage);
+        jit::release(&extras->jit);
+        free(extras->owned_tables);
+        free(extras);
+    }
+}
+
+// Swap xform's float program for byte lookups, a lowp program if asked for one, or machine code,
+// whichever first can stand in for it.  Only lowp changes any output.  xform must have its
+// TransformExtras.
+static void build_fast_paths(skcms_CompiledTransform* xform, bool lowp) {
+    if (kProfiling) {
+        return;
+    }
+    build_byte_luts(xform);
+    if (!xform->extras->use_byte_luts && lowp) {
+        build_lowp(xform);
+    }
+    if (!xform->extras->use_byte_luts && !xform->extras->use_lowp) {
+        build_jit(xform);
+    }
+}
+
+// We can't transform in place unless src and dst pixels have the same size and layout.
+static bool bad_alias(const skcms_CompiledTransform* xform, const void* src, const void* dst) {
+    return dst == src && (xform->dst_bpp           != xform->src_bpp ||
+                          xform->dst_layout.planes != xform->src_layout.planes);
+}
+
+static bool run_transform(const skcms_CompiledTransform* xform,
+                          const void* src, void* dst, size_t nz) {
+    if (bad_alias(xform, src, dst)) {
+        return false;
+    }
+    // TODO: more careful alias rejection (like, dst == src + 1)?
+
+    run_span(xform, src, dst, 0, nz);
+    return true;
+}
+
+bool skcms_Transform(const void*             src,
+                     skcms_PixelFormat       srcFmt,
+                     skcms_AlphaFormat       srcAlpha,
+                     const skcms_ICCProfile* srcProfile,
+                     void*                   dst,
+                     skcms_PixelFormat       dstFmt,
+                     skcms_AlphaFormat       dstAlpha,
+                     const skcms_ICCProfile* dstProfile,
+                     size_t                  nz) {
+    // Null profiles default to sRGB. Passing null for both is handy when doing format conversion.
+    if (!srcProfile) {
+        srcProfile = skcms_sRGB_profile();
+    }
+    if (!dstProfile) {
+        dstProfile = skcms_sRGB_profile();
+    }
+
+    // Only calls with enough pixels to want fast paths pay to allocate somewhere to keep them.
+    TransformExtras* extras = nz >= kByteLUTMinPixels ? new_extras() : nullptr;
+    skcms_CompiledTransform xform;
+    if (!compile_transform(&xform, srcFmt, srcAlpha, srcProfile,
+                                   dstFmt, dstAlpha, dstProfile,
+                           nullptr, skcms_Interpolation_Multilinear, current_backend(), extras)) {
+        free_extras(extras);
+        return false;
+    }
+    if (extras && nz >= kFastPathMinPixels) {
+        decode_tables(&xform);
+        build_fast_paths(&xform, /*lowp=*/false);
+    } else if (extras) {
+        build_byte_luts(&xform);
+    }
+    const bool ok = run_transform(&xform, src, dst, nz);
+    free_extras(extras);
+    return ok;
+}
+
+// Call fn(&ptr, len) for each curve table and CLUT grid that a transform using p might read.
+template <typename Fn>
+static void for_each_table(skcms_ICCProfile* p, Fn&& fn) {
+    auto curves = [&](skcms_Curve* curve, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, curve++) {
+            if (curve->table_entries && curve->table_8) {
+                fn(&curve->table_8, (uint64_t)curve->table_entries);
+            }
+            if (curve->table_entries && curve->table_16) {
+                fn(&curve->table_16, (uint64_t)curve->table_entries * 2);
+            }
+        }
+    };
+    auto grid = [&](const uint8_t** grid_8, const uint8_t** grid_16,
+                    const uint8_t grid_points[4], uint32_t dim, uint32_t output_channels) {
+        uint64_t entries = output_channels;
+        for (uint32_t i = 0; i < dim; i++) {
+            entries *= grid_points[i];
+        }
+        if (*grid_8)  { fn(grid_8 , entries  ); }
+        if (*grid_16) { fn(grid_16, entries*2); }
+    };
+
+    if (p->has_trc) {
+        curves(p->trc, 3);
+    }
+    if (p->has_A2B) {
+        skcms_A2B* a2b = &p->A2B;
+        if (a2b->input_channels) {
+            curves(a2b->input_curves, a2b->input_channels);
+            grid(&a2b->grid_8, &a2b->grid_16, a2b->grid_points,
+                 a2b->input_channels, a2b->output_channels);
+        }
+        if (a2b->matrix_channels) {
+            curves(a2b->matrix_curves, 3);
+        }
+        curves(a2b->output_curves, 3);
+    }
+    if (p->has_B2A) {
+        skcms_B2A* b2a = &p->B2A;
+        curves(b2a->input_curves, 3);
+        if (b2a->matrix_channels) {
+            curves(b2a->matrix_curves, 3);
+        }
+        if (b2a->output_channels) {
+            grid(&b2a->grid_8, &b2a->grid_16, b2a->grid_points,
+                 b2a->input_channels, b2a->output_channels);
+            curves(b2a->output_curves, b2a->output_channels);
+        }
+    }
+}
+
+// Point the tables of src and dst at copies owned by xform, so that the caller's profiles and
+// ICC buffers need not outlive it.  dst may be null when it's the same profile as src.
+static bool copy_tables(TransformExtras* extras, skcms_ICCProfile* src, skcms_ICCProfile* dst) {
+    // Our gathers may read a few bytes past the end of a table or grid (e.g. gather_24 and
+    // gather_48), so we pad each copy, and keep them all 16-byte aligned while we're at it.
+    auto padded = [](uint64_t len) { return (len + 8 + 15) & ~(uint64_t)15; };
+
+    uint64_t total = 0;
+    auto measure = [&](const uint8_t**, uint64_t len) { total += padded(len); };
+    for_each_table(src, measure);
+    if (dst) {
+        for_each_table(dst, measure);
+    }
+
+    if (total == 0) {
+        return true;
+    }
+    if (total > SIZE_MAX || !(extras->owned_tables = calloc(1, (size_t)total))) {
+        return false;
+    }
+
+    uint8_t* cursor = (uint8_t*)extras->owned_tables;
+    auto copy = [&](const uint8_t** table, uint64_t len) {
+        memcpy(cursor, *table, (size_t)len);
+        *table  = cursor;
+        cursor += padded(len);
+    };
+    for_each_table(src, copy);
+    if (dst) {
+        for_each_table(dst, copy);
+    }
+    return true;
+}
+
+static skcms_CompiledTransform* create_transform(skcms_PixelFormat       srcFmt,
+                                                 skcms_AlphaFormat       srcAlpha,
+                                                 const skcms_ICCProfile* srcProfile,
+                                                 skcms_PixelFormat       dstFmt,
+                                                 skcms_AlphaFormat       dstAlpha,
+                                                 const skcms_ICCProfile* dstProfile,
+                                                 skcms_Interpolation     interpolation,
+                                                 CpuType                 cpu,
+                                                 skcms_CLUTLayout        layout
+                                                                             = skcms_CLUTLayout_ICC,
+                                                 bool                    lowp = false) {
+    if (!srcProfile) {
+        srcProfile = skcms_sRGB_profile();
+    }
+    if (!dstProfile) {
+        dstProfile = skcms_sRGB_profile();
+    }
+
+    auto xform = (skcms_CompiledTransform*)malloc(sizeof(skcms_CompiledTransform));
+    TransformExtras* extras = new_extras();
+    if (!xform || !extras) {
+        free(xform);
+        free_extras(extras);
+        return nullptr;
+    }
+    xform->refs.store(1);
+
+    // The program only ever reads the parsed fields of each profile, never its ICC buffer.
+    auto copy_profile = [](skcms_ICCProfile* copy, const skcms_ICCProfile* profile) {
+        *copy = *profile;
+        copy->buffer    = nullptr;
+        copy->size      = 0;
+        copy->tag_count = 0;
+    };
+    const bool same_profile = (srcProfile == dstProfile);
+    copy_profile(&extras->src_profile, srcProfile);
+    copy_profile(&extras->dst_profile, dstProfile);
+
+    if (!copy_tables(extras, &extras->src_profile, same_profile ? nullptr
+                                                                : &extras->dst_profile) ||
+        !compile_transform(xform, srcFmt, srcAlpha, &extras->src_profile,
+                                  dstFmt, dstAlpha, same_profile ? &extras->src_profile
+                                                                 : &extras->dst_profile,
+                           nullptr, interpolation, cpu, extras)) {
+        free(xform);
+        free_extras(extras);
+        return nullptr;
+    }
+    decode_tables(xform);
+    if (layout == skcms_CLUTLayout_Packed || layout == skcms_CLUTLayout_Blocked) {
+        pack_cluts(xform, layout == skcms_CLUTLayout_Blocked);
+    }
+    build_fast_paths(xform, lowp);
+    return xform;
+}
+
+skcms_CompiledTransform* skcms_TransformCreateWithInterpolation(
+        skcms_PixelFormat       srcFmt,
+        skcms_AlphaFormat       srcAlpha,
+        const skcms_ICCProfile* srcProfile,
+        skcms_PixelFormat       dstFmt,
+        skcms_AlphaFormat       dstAlpha,
+        const skcms_ICCProfile* dstProfile,
+        skcms_Interpolation     interpolation) {
+    return create_transform(srcFmt, srcAlpha, srcProfile,
+                            dstFmt, dstAlpha, dstProfile,
+                            interpolation, current_backend());
+}
+
+skcms_CompiledTransform* skcms_TransformCreateWithBackend(skcms_PixelFormat       srcFmt,
+                                                          skcms_AlphaFormat       srcAlpha,
+                                                          const skcms_ICCProfile* srcProfile,
+                                                          skcms_PixelFormat       dstFmt,
+                                                          skcms_AlphaFormat       dstAlpha,
+                                                          const skcms_ICCProfile* dstProfile,
+                                                          skcms_Backend           backend) {
+    CpuType cpu;
+    if (!backend_cpu_type(backend, &cpu)) {
+        return nullptr;
+    }
+    return create_transform(srcFmt, srcAlpha, srcProfile,
+                            dstFmt, dstAlpha, dstProfile,
+                            skcms_Interpolation_Multilinear, cpu);
+}
+
+skcms_CompiledTransform* skcms_TransformCreateWithCLUTLayout(skcms_PixelFormat       srcFmt,
+                                                             skcms_AlphaFormat       srcAlpha,
+                                                             const skcms_ICCProfile* srcProfile,
+                                                             skcms_PixelFormat       dstFmt,
+                                                             skcms_AlphaFormat       dstAlpha,
+                                                             const skcms_ICCProfile* dstProfile,
+                                                             skcms_CLUTLayout        layout) {
+    return create_transform(srcFmt, srcAlpha, srcProfile,
+                            dstFmt, dstAlpha, dstProfile,
+                            skcms_Interpolation_Multilinear, current_backend(), layout);
+}
+
+skcms_CompiledTransform* skcms_TransformCreateLowp(skcms_PixelFormat       srcFmt,
+                                                   skcms_AlphaFormat       srcAlpha,
+                                                   const skcms_ICCProfile* srcProfile,
+                                                   skcms_PixelFormat       dstFmt,
+                                                   skcms_AlphaFormat       dstAlpha,
+                                                   const skcms_ICCProfile* dstProfile) {
+    return create_transform(srcFmt, srcAlpha, srcProfile,
+                            dstFmt, dstAlpha, dstProfile,
+                            skcms_Interpolation_Multilinear, current_backend(),
+                            skcms_CLUTLayout_ICC, /*lowp=*/true);
+}
+
+skcms_Backend skcms_TransformGetBackend(const skcms_CompiledTransform* xform) {
+    return public_backend(xform->cpu);
+}
+
+// Append to the string in buf, truncating if it doesn't fit.
+#if defined(__clang__) || defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+static void append(char* buf, size_t len, const char* fmt, ...) {
+    const size_t used = strlen(buf);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf + used, len - used, fmt, args);
+    va_end(args);
+}
+
+// Summarize what op reads from its context into buf, or leave buf empty if it reads nothing.
+static void describe_context(Op op, const void* ctx, char* buf, size_t len) {
+    buf[0] = '\0';
+    auto describe_grid = [&](uint32_t inputs, uint32_t outputs, const uint8_t* grid_points,
+                             bool is_8bit) {
+        append(buf, len, "%u -> %u channels, ", inputs, outputs);
+        for (uint32_t i = 0; i < inputs; i++) {
+            append(buf, len, "%s%u", i ? "x" : "", grid_points[i]);
+        }
+        append(buf, len, " grid, %s", is_8bit ? "8-bit" : "16-bit");
+    };
+
+    switch (op) {
+        case Op::gamma_r:  case Op::gamma_g:  case Op::gamma_b:  case Op::gamma_a:
+        case Op::gamma_rgb:
+        case Op::tf_r:     case Op::tf_g:     case Op::tf_b:     case Op::tf_a:
+        case Op::tf_rgb:
+        case Op::pq_r:     case Op::pq_g:     case Op::pq_b:     case Op::pq_a:
+        case Op::pq_rgb:
+        case Op::hlg_r:    case Op::hlg_g:    case Op::hlg_b:    case Op::hlg_a:
+        case Op::hlg_rgb:
+        case Op::hlginv_r: case Op::hlginv_g: case Op::hlginv_b: case Op::hlginv_a:
+        case Op::hlginv_rgb: {
+            const skcms_TransferFunction* tf = (const skcms_TransferFunction*)ctx;
+            append(buf, len, "g=%g a=%g b=%g c=%g d=%g e=%g f=%g",
+                   (double)tf->g, (double)tf->a, (double)tf->b, (double)tf->c,
+                   (double)tf->d, (double)tf->e, (double)tf->f);
+        } break;
+
+        case Op::table_r: case Op::table_g: case Op::table_b: case Op::table_a: {
+            const TableLUT* lut = (const TableLUT*)ctx;
+            append(buf, len, "%u entries, %s", lut->curve->table_entries,
+                   lut->pairs ? "decoded" : lut->curve->table_8 ? "8-bit" : "16-bit");
+        } break;
+
+        case Op::table_small_r: case Op::table_small_g:
+        case Op::table_small_b: case Op::table_small_a: {
+            const SmallTable* table = (const SmallTable*)ctx;
+            append(buf, len, "%d entries, decoded", (int)table->scale + 1);
+        } break;
+
+        case Op::matrix_3x3: {
+            const skcms_Matrix3x3* m = (const skcms_Matrix3x3*)ctx;
+            for (int r = 0; r < 3; r++) {
+                append(buf, len, "%s%.4g %.4g %.4g", r ? "; " : "",
+                       (double)m->vals[r][0], (double)m->vals[r][1], (double)m->vals[r][2]);
+            }
+        } break;
+
+        case Op::matrix_3x4: {
+            const skcms_Matrix3x4* m = (const skcms_Matrix3x4*)ctx;
+            for (int r = 0; r < 3; r++) {
+                append(buf, len, "%s%.4g %.4g %.4g %.4g", r ? "; " : "",
+                       (double)m->vals[r][0], (double)m->vals[r][1],
+                       (double)m->vals[r][2], (double)m->vals[r][3]);
+            }
+        } break;
+
+        case Op::clut_A2B: case Op::clut_A2B_simplex:
+        case Op::clut_B2A: case Op::clut_B2A_simplex: {
+            const CLUT* clut = (const CLUT*)ctx;
+            describe_grid(clut->input_channels, clut->output_channels, clut->grid_points,
+                          clut->grid_8 != nullptr);
+            if (clut->packed) {
+                append(buf, len, clut->blocked ? ", packed, blocked" : ", packed");
+            }
+        } break;
+
+        case Op::baked_lut: {
+            const BakedLUT* lut = (const BakedLUT*)ctx;
+            append(buf, len, "%d^3 grid", lut->grid_points);
+        } break;
+
+        default:
+            break;
+    }
+}
+
+void skcms_DescribeTransform(const skcms_CompiledTransform* xform,
+                             skcms_TransformDescription* desc) {
+    desc->backend = public_backend(xform->cpu);
+    const TransformExtras* extras = xform->extras;
+    desc->path    = extras && extras->use_byte_luts ? "byte LUTs"
+                  : extras && extras->use_lowp      ? "lowp"
+                  : extras && extras->jit.code      ? "JIT"
+                  : xform->kernel                   ? "kernel"
+                  :                                   "interpreter";
+
+    static_assert(ARRAY_COUNT(desc->ops) == ARRAY_COUNT(xform->program), "");
+    desc->op_count = (int)xform->program_size;
+    for (int i = 0; i < desc->op_count; i++) {
+        desc->ops[i] = op_name(xform->program[i]);
+        describe_context(xform->program[i], xform->contexts[i],
+                         desc->contexts[i], sizeof(desc->contexts[i]));
+    }
+}
+
+skcms_CompiledTransform* skcms_TransformCreate(skcms_PixelFormat       srcFmt,
+                                               skcms_AlphaFormat       srcAlpha,
+                                               const skcms_ICCProfile* srcProfile,
+                                               skcms_PixelFormat       dstFmt,
+                                               skcms_AlphaFormat       dstAlpha,
+                                               const skcms_ICCProfile* dstProfile) {
+    return skcms_TransformCreateWithInterpolation(srcFmt, srcAlpha, srcProfile,
+                                                  dstFmt, dstAlpha, dstProfile,
+                                                  skcms_Interpolation_Multilinear);
+}
+
+// Baked grids have at most 65^3 entries, about 3MB of floats.
+static constexpr int kMaxBakedGridPoints = 65;
+
+static bool is_rgb_888_or_8888(skcms_PixelFormat fmt) {
+    return (fmt >> 1) == (skcms_PixelFormat_RGB_888   >> 1)
+        || (fmt >> 1) == (skcms_PixelFormat_RGBA_8888 >> 1);
+}
+
+// How far a baked transform strays from the exact one, in 8-bit steps, over every fifth code
+// value in each source channel.  Both are compared in float, before rounding to 8 bits.
+static float baked_max_error(const skcms_ICCProfile* srcProfile,
+                             const skcms_ICCProfile* dstProfile,
+                             const BakedLUT* lut) {
+    const skcms_AlphaFormat opaque = skcms_AlphaFormat_Opaque;
+    skcms_CompiledTransform exact, baked;
+    if (!compile_transform(&exact, skcms_PixelFormat_RGB_888, opaque, srcProfile,
+                                   skcms_PixelFormat_RGB_fff, opaque, dstProfile) ||
+        !compile_transform(&baked, skcms_PixelFormat_RGB_888, opaque, srcProfile,
+                                   skcms_PixelFormat_RGB_fff, opaque, dstProfile, lut)) {
+        return INFINITY_;
+    }
+
+    constexpr int kSteps = 255/5 + 1;
+    uint8_t src[3*kSteps];
+    float   want[3*kSteps],
+            got [3*kSteps];
+    auto clamp01 = [](float v) { return fmaxf_(0.0f, fminf_(v, 1.0f)); };
+
+    float worst = 0;
+    for (int r = 0; r < kSteps; r++)
+    for (int g = 0; g < kSteps; g++) {
+        for (int b = 0; b < kSteps; b++) {
+            src[3*b+0] = (uint8_t)(5*r);
+            src[3*b+1] = (uint8_t)(5*g);
+            src[3*b+2] = (uint8_t)(5*b);
+        }
+        run_transform(&exact, src, want, kSteps);
+        run_transform(&baked, src, got , kSteps);
+        for (int i = 0; i < 3*kSteps; i++) {
+            worst = fmaxf_(worst, fabsf_(clamp01(got[i]) - clamp01(want[i])) * 255);
+        }
+    }
+    return worst;
+}
+
+skcms_CompiledTransform* skcms_TransformCreateBaked(skcms_PixelFormat       srcFmt,
+                                                    skcms_AlphaFormat       srcAlpha,
+                                                    const skcms_ICCProfile* srcProfile,
+                                                    skcms_PixelFormat       dstFmt,
+                                                    skcms_AlphaFormat       dstAlpha,
+                                                    const skcms_ICCProfile* dstProfile,
+                                                    int                     gridPoints,
+                                                    float*                  maxError) {
+    if (!srcProfile) {
+        srcProfile = skcms_sRGB_profile();
+    }
+    if (!dstProfile) {
+        dstProfile = skcms_sRGB_profile();
+    }
+    // The grid samples three source channels and holds three destination channels.
+    if (!is_rgb_888_or_8888(srcFmt) || !is_rgb_888_or_8888(dstFmt) ||
+            gridPoints < 2 || gridPoints > kMaxBakedGridPoints ||
+            srcProfile->data_color_space == skcms_Signature_CMYK ||
+            dstProfile->data_color_space == skcms_Signature_CMYK) {
+        return nullptr;
+    }
+
+    // Sample the exact conversion at each grid point, transforming the grid in place.
+    skcms_CompiledTransform exact;
+    if (!compile_transform(&exact, skcms_PixelFormat_RGB_fff, skcms_AlphaFormat_Opaque,
+                                   srcProfile,
+                                   skcms_PixelFormat_RGB_fff, skcms_AlphaFormat_Opaque,
+                                   dstProfile)) {
+        return nullptr;
+    }
+    const size_t entries = (size_t)gridPoints * (size_t)gridPoints * (size_t)gridPoints;
+    float* table = (float*)malloc(3 * entries * sizeof(float));
+    if (!table) {
+        return nullptr;
+    }
+    const float scale = 1.0f / (float)(gridPoints - 1);
+    for (int r = 0, i = 0; r < gridPoints; r++)
+    for (int g = 0;        g < gridPoints; g++)
+    for (int b = 0;        b < gridPoints; b++, i += 3) {
+        table[i+0] = (float)r * scale;
+        table[i+1] = (float)g * scale;
+        table[i+2] = (float)b * scale;
+    }
+    run_transform(&exact, table, table, entries);
+
+    auto xform = (skcms_CompiledTransform*)malloc(sizeof(skcms_CompiledTransform));
+    TransformExtras* extras = new_extras();
+    if (!xform || !extras) {
+        free(table);
+        free(xform);
+        free_extras(extras);
+        return nullptr;
+    }
+    xform->refs.store(1);
+    extras->owned_tables = table;
+    extras->baked_lut    = { gridPoints, table };
+
+    if (!compile_transform(xform, srcFmt, srcAlpha, srcProfile,
+                                  dstFmt, dstAlpha, dstProfile, &extras->baked_lut,
+                           skcms_Interpolation_Multilinear, current_backend(), extras)) {
+        free(xform);
+        free_extras(extras);
+        return nullptr;
+    }
+    if (maxError) {
+        *maxError = baked_max_error(srcProfile, dstProfile, &extras->baked_lut);
+    }
+    return xform;
+}
+
+bool skcms_TransformRun(const skcms_CompiledTransform* xform,
+                        const void* src, void* dst, size_t npixels) {
+    return run_transform(xform, src, dst, npixels);
+}
+
+void skcms_TransformDestroy(skcms_CompiledTransform* xform) {
+    if (xform) {
+        free_extras(xform->extras);
+        free(xform);
+    }
+}
+
+// Parallel transforms split the span into chunks of about this many bytes of the larger of
+// src and dst, which should keep each chunk's working set comfortably inside L2.
+static constexpr size_t kParallelChunkBytes = 256 * 1024;
+
+struct ParallelTransform {
+    const skcms_CompiledTransform* xform;
+    const void*                    src;
+    void*                          dst;
+    size_t                         npixels,
+                                   chunk;
+};
+
+static void run_parallel_chunk(void* ctx, int i) {
+    const ParallelTransform* job = (const ParallelTransform*)ctx;
+    const skcms_CompiledTransform* xform = job->xform;
+
+    size_t start = (size_t)i * job->chunk,
+           n     = job->npixels - start < job->chunk ? job->npixels - start : job->chunk;
+    run_span(xform, job->src, job->dst, start, n);
+}
+
+#if !defined(SKCMS_NO_THREADS)
+struct TaskRun {
+    std::atomic<int> next;
+    int              end;
+};
+
+struct TaskWorker {
+    TaskRun* runs;
+    int      threads,
+             t;
+    void   (*task)(void* task_ctx, int i);
+    void*    task_ctx;
+#if defined(_WIN32)
+    HANDLE    thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// Run worker->t's own tasks, then help with everyone else's.
+static void work_on_tasks(const TaskWorker* worker) {
+    for (int k = 0; k < worker->threads; k++) {
+        TaskRun& run = worker->runs[(worker->t + k) % worker->threads];
+        for (int i; (i = run.next.fetch_add(1, std::memory_order_relaxed)) < run.end;) {
+            worker->task(worker->task_ctx, i);
+        }
+    }
+}
+
+// We start and join threads with the platform APIs, which report failure by return value
+// rather than by throwing like std::thread does.
+#if defined(_WIN32)
+    static unsigned __stdcall task_thread_main(void* arg) {
+        work_on_tasks((const TaskWorker*)arg);
+        return 0;
+    }
+    static bool start_task_thread(TaskWorker* worker) {
+        worker->thread = (HANDLE)_beginthreadex(nullptr, 0, task_thread_main, worker, 0, nullptr);
+        return worker->thread != nullptr;
+    }
+    static void join_task_thread(TaskWorker* worker) {
+        WaitForSingleObject(worker->thread, INFINITE);
+        CloseHandle(worker->thread);
+    }
+#else
+    static void* task_thread_main(void* arg) {
+        work_on_tasks((const TaskWorker*)arg);
+        return nullptr;
+    }
+    static bool start_task_thread(TaskWorker* worker) {
+        return 0 == pthread_create(&worker->thread, nullptr, task_thread_main, worker);
+    }
+    static void join_task_thread(TaskWorker* worker) {
+        pthread_join(worker->thread, nullptr);
+    }
+#endif
+
+// skcms' built-in skcms_TaskRunner.  Each worker owns a contiguous run of tasks, taking them
+// in order from the front.  Once it runs out, it steals tasks from the other workers' runs.
+// If we can't allocate or start as many threads as asked for, the calling thread picks up
+// whatever work is left over.
+static void run_tasks_on_threads(void* runner_ctx, int count,
+                                 void (*task)(void* task_ctx, int i), void* task_ctx) {
+    int threads = *(const int*)runner_ctx;
+    if (threads > count) {
+        threads = count;
+    }
+
+    TaskRun*    runs    = nullptr;
+    TaskWorker* workers = nullptr;
+    if (threads > 1) {
+        runs    = (TaskRun*   )malloc(sizeof(TaskRun)    * (size_t)threads);
+        workers = (TaskWorker*)malloc(sizeof(TaskWorker) * (size_t)threads);
+    }
+    if (!runs || !workers) {
+        free(runs);
+        free(workers);
+        for (int i = 0; i < count; i++) {
+            task(task_ctx, i);
+        }
+        return;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        new (&runs[t].next) std::atomic<int>((int)((int64_t)count * t / threads));
+        runs[t].end = (int)((int64_t)count * (t+1) / threads);
+        workers[t] = {runs, threads, t, task, task_ctx, {}};
+    }
+
+    int started = 1;
+    while (started < threads && start_task_thread(&workers[started])) {
+        started++;
+    }
+    work_on_tasks(&workers[0]);
+    for (int t = 1; t < started; t++) {
+        join_task_thread(&workers[t]);
+    }
+    free(workers);
+    free(runs);
+}
+#endif
+
+bool skcms_TransformRunWithRunner(const skcms_CompiledTransform* xform,
+                                  const void* src, void* dst, size_t npixels,
+                                  skcms_TaskRunner* runner, void* runner_ctx) {
+    // Same aliasing rules as skcms_Transform().
+    if (bad_alias(xform, src, dst)) {
+        return false;
+    }
+
+    // Chunks start at multiples of 16 pixels, the widest any run_program() works at once.
+    const size_t bpp = xform->src_bpp > xform->dst_bpp ? xform->src_bpp : xform->dst_bpp;
+    size_t chunk = (kParallelChunkBytes / bpp) & ~(size_t)15;
+
+    // Small calls aren't worth handing off to other threads.
+    if (!runner || npixels < 2 * chunk) {
+        return run_transform(xform, src, dst, npixels);
+    }
+
+    while ((npixels + chunk - 1) / chunk > INT_MAX) {
+        chunk *= 2;
+    }
+    ParallelTransform job = { xform, src, dst, npixels, chunk };
+    runner(runner_ctx, (int)((npixels + chunk - 1) / chunk), run_parallel_chunk, &job);
+    return true;
+}
+
+struct ParallelImage {
+    const skcms_CompiledTransform* xform;
+    const void*                    src;
+    void*                          dst;
+    size_t                         src_stride,
+                                   dst_stride;
+    int                            width,
+                                   height,
+                                   band;  // Rows per task.
+};
+
+// Row y of an image whose rows are stride bytes apart, or for planar formats, a
+// skcms_PlanarBuffer in *storage pointing at row y of each plane.  Planes with their own stride
+// use it instead, and subsampled planes move down a row every 1<<vshift rows of the image.
+static const void* image_row(const void* pixels, const PlanarLayout& layout, int vshift,
+                             size_t stride, int y, skcms_PlanarBuffer* storage) {
+    if (layout.planes == 0) {
+        return (const char*)pixels + (size_t)y * stride;
+    }
+    const skcms_PlanarBuffer* buffer = (const skcms_PlanarBuffer*)pixels;
+    for (int p = 0; p < layout.planes; p++) {
+        const size_t plane_stride = buffer->strides[p] ? buffer->strides[p] : stride;
+        const int    plane_y      = layout.shift[p] ? y >> vshift : y;
+        storage->planes[p]  = (char*)buffer->planes[p] + (size_t)plane_y * plane_stride;
+        storage->strides[p] = buffer->strides[p];
+    }
+    return storage;
+}
+
+// Whether each row of the image (or of each of its planes) fits in its stride, and in *packed,
+// whether rows follow one another with no gaps, so the whole image is really one long span.
+static bool rows_fit(const void* pixels, const PlanarLayout& layout, int vshift, size_t bpp,
+                     size_t stride, int width, bool* packed) {
+    if (layout.planes == 0) {
+        *packed = stride == (size_t)width * bpp;
+        return stride >= (size_t)width * bpp;
+    }
+    const skcms_PlanarBuffer* buffer = (const skcms_PlanarBuffer*)pixels;
+    *packed = vshift == 0;
+    for (int p = 0; p < layout.planes; p++) {
+        const size_t plane_stride = buffer->strides[p] ? buffer->strides[p] : stride,
+                     plane_row    = (((size_t)width + (1u << layout.shift[p]) - 1)
+                                                    >> layout.shift[p]) * layout.bytes[p];
+        if (plane_stride < plane_row) {
+            return false;
+        }
+        *packed = *packed && layout.shift[p] == 0 && plane_stride == plane_row;
+    }
+    return true;
+}
+
+static void run_image_rows(const skcms_CompiledTransform* xform,
+                           const void* src, size_t src_stride,
+                           void*       dst, size_t dst_stride,
+                           int width, int y, int rows) {
+    for (; rows > 0; rows--, y++) {
+        skcms_PlanarBuffer src_planes, dst_planes;
+        run_span(xform,
+                 image_row(src, xform->src_layout, xform->src_chroma_vshift, src_stride, y,
+                           &src_planes),
+                 (void*)image_row(dst, xform->dst_layout, 0, dst_stride, y, &dst_planes),
+                 0, (size_t)width);
+    }
+}
+
+static void run_parallel_band(void* ctx, int i) {
+    const ParallelImage* job = (const ParallelImage*)ctx;
+    const int y    = i * job->band,
+              rows = job->height - y < job->band ? job->height - y : job->band;
+    run_image_rows(job->xform, job->src, job->src_stride, job->dst, job->dst_stride,
+                   job->width, y, rows);
+}
+
+static bool run_image(const skcms_CompiledTransform* xform,
+                      const void* src, size_t src_stride,
+                      void*       dst, size_t dst_stride,
+                      int width, int height,
+                      skcms_TaskRunner* runner, void* runner_ctx) {
+    if (width < 0 || height < 0) {
+        return false;
+    }
+    if (width == 0 || height == 0) {
+        return true;
+    }
+    bool src_packed, dst_packed;
+    if (!rows_fit(src, xform->src_layout, xform->src_chroma_vshift, xform->src_bpp,
+                  src_stride, width, &src_packed) ||
+        !rows_fit(dst, xform->dst_layout, 0, xform->dst_bpp,
+                  dst_stride, width, &dst_packed)) {
+        return false;
+    }
+    // In place is fine only if each row lands exactly where it came from.
+    if (bad_alias(xform, src, dst) || (dst == src && src_stride != dst_stride)) {
+        return false;
+    }
+
+    // Tightly packed rows are just one long span.
+    if (src_packed && dst_packed) {
+        return skcms_TransformRunWithRunner(xform, src, dst, (size_t)width * (size_t)height,
+                                            runner, runner_ctx);
+    }
+
+    // Each task covers a band of whole rows, about kParallelChunkBytes in all.
+    const size_t row_bytes = (size_t)width * (xform->src_bpp > xform->dst_bpp ? xform->src_bpp
+                                                                              : xform->dst_bpp);
+    const int band = row_bytes >= kParallelChunkBytes ? 1 : (int)(kParallelChunkBytes / row_bytes);
+    if (!runner || height < 2 * band) {
+        run_image_rows(xform, src, src_stride, dst, dst_stride, width, 0, height);
+        return true;
+    }
 
-    run(program, context, ops - program, (const char*)src, (char*)dst, n, src_bpp,dst_bpp);
+    ParallelImage job = { xform, src, dst, src_stride, dst_stride, width, height, band };
+    runner(runner_ctx, (height - 1) / band + 1, run_parallel_band, &job);
     return true;
 }
 
+bool skcms_TransformRunImage(const skcms_CompiledTransform* xform,
+                             const void* src, size_t src_stride,
+                             void*       dst, size_t dst_stride,
+                             int width, int height) {
+    return run_image(xform, src, src_stride, dst, dst_stride, width, height, nullptr, nullptr);
+}
+
+bool skcms_TransformRunImageWithRunner(const skcms_CompiledTransform* xform,
+                                       const void* src, size_t src_stride,
+                                       void*       dst, size_t dst_stride,
+                                       int width, int height,
+                                       skcms_TaskRunner* runner, void* runner_ctx) {
+    return run_image(xform, src, src_stride, dst, dst_stride, width, height, runner, runner_ctx);
+}
+
+bool skcms_TransformImage(const void*             src,
+                          skcms_PixelFormat       srcFmt,
+                          skcms_AlphaFormat       srcAlpha,
+                          const skcms_ICCProfile* srcProfile,
+                          size_t                  srcStride,
+                          void*                   dst,
+                          skcms_PixelFormat       dstFmt,
+                          skcms_AlphaFormat       dstAlpha,
+                          const skcms_ICCProfile* dstProfile,
+                          size_t                  dstStride,
+                          int                     width,
+                          int                     height) {
+    if (!srcProfile) {
+        srcProfile = skcms_sRGB_profile();
+    }
+    if (!dstProfile) {
+        dstProfile = skcms_sRGB_profile();
+    }
+
+    const size_t npixels = width > 0 && height > 0 ? (size_t)width * (size_t)height : 0;
+    TransformExtras* extras = npixels >= kByteLUTMinPixels ? new_extras() : nullptr;
+    skcms_CompiledTransform xform;
+    if (!compile_transform(&xform, srcFmt, srcAlpha, srcProfile,
+                                   dstFmt, dstAlpha, dstProfile,
+                           nullptr, skcms_Interpolation_Multilinear, current_backend(), extras)) {
+        free_extras(extras);
+        return false;
+    }
+    if (extras && npixels >= kFastPathMinPixels) {
+        build_fast_paths(&xform, /*lowp=*/false);
+    } else if (extras) {
+        build_byte_luts(&xform);
+    }
+    const bool ok = run_image(&xform, src, srcStride, dst, dstStride, width, height,
+                              nullptr, nullptr);
+    free_extras(extras);
+    return ok;
+}
+
+bool skcms_TransformRunParallel(const skcms_CompiledTransform* xform,
+                                const void* src, void* dst, size_t npixels, int threads) {
+#if defined(SKCMS_NO_THREADS)
+    (void)threads;
+    return skcms_TransformRunWithRunner(xform, src, dst, npixels, nullptr, nullptr);
+#else
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+    return skcms_TransformRunWithRunner(xform, src, dst, npixels,
+                                        threads > 1 ? run_tasks_on_threads : nullptr, &threads);
+#endif
+}
+
+// A small, bounded, thread-safe LRU cache of compiled transforms for skcms_TransformCached().
+// Keys are hashed to one of a few shards, each with its own lock, a handful of slots, and a
+// clock to track which of those slots was least recently used.
+//
+// Keys hash only the arguments and profile fields that are cheap to read, not table or grid
+// contents, so they just narrow the search.  A slot only matches once we've compared the
+// caller's profiles in full against the copies its transform holds.
+static constexpr int kTransformCacheShards = 8,
+                     kTransformCacheWays   = 8;
+
+struct TransformCacheSlot {
+    uint64_t                 key;
+    skcms_PixelFormat        srcFmt,
+                             dstFmt;
+    skcms_AlphaFormat        srcAlpha,
+                             dstAlpha;
+    CpuType                  cpu;
+    bool                     same_profile;
+    skcms_CompiledTransform* xform;
+    uint64_t                 last_used;
+};
+
+struct TransformCacheShard {
+    std::mutex         lock;
+    uint64_t           clock;
+    TransformCacheSlot slots[kTransformCacheWays];
+};
+
+// Allocated on first use and never freed, to avoid needing a static constructor or destructor.
+static TransformCacheShard* transform_cache() {
+    static TransformCacheShard* shards = new TransformCacheShard[kTransformCacheShards]();
+    return shards;
+}
+
+static std::atomic<uint64_t> gTransformCacheHits{0},
+                             gTransformCacheMisses{0},
+                             gTransformCacheEvictions{0};
+
+static void release_cached_transform(skcms_CompiledTransform* xform) {
+    if (xform->refs.fetch_sub(1) == 1) {
+        skcms_TransformDestroy(xform);
+    }
+}
+
+bool skcms_TransformCached(const void*             src,
+                           skcms_PixelFormat       srcFmt,
+                           skcms_AlphaFormat       srcAlpha,
+                           const skcms_ICCProfile* srcProfile,
+                           void*                   dst,
+                           skcms_PixelFormat       dstFmt,
+                           skcms_AlphaFormat       dstAlpha,
+                           const skcms_ICCProfile* dstProfile,
+                           size_t                  npixels) {
+    if (!srcProfile) {
+        srcProfile = skcms_sRGB_profile();
+    }
+    if (!dstProfile) {
+        dstProfile = skcms_sRGB_profile();
+    }
+
+    // Transforming a profile to itself skips color conversion entirely, so that's part of the
+    // key too, alongside both profiles and the backend to run with.
+    const bool    same_profile = srcProfile == dstProfile;
+    const CpuType cpu          = current_backend();
+    Hasher hasher;
+    hasher.u32((uint32_t)srcFmt);
+    hasher.u32((uint32_t)srcAlpha);
+    hasher.u32((uint32_t)dstFmt);
+    hasher.u32((uint32_t)dstAlpha);
+    hasher.u32((uint32_t)cpu);
+    hasher.profile(srcProfile, /*contents=*/false);
+    hasher.u32(same_profile);
+    if (!same_profile) {
+        hasher.profile(dstProfile, /*contents=*/false);
+    }
+    const uint64_t key = hasher.finish().lo;
+
+    // Only called with the shard locked, so slot.xform can't go away while we look at it.
+    // When transforming a profile to itself, only src_profile owns copies of its tables, and
+    // (when drawing to gray) both its A2B and B2A may be used.
+    auto matches = [&](const TransformCacheSlot& slot) {
+        return slot.xform
+            && slot.key          == key
+            && slot.srcFmt       == srcFmt
+            && slot.srcAlpha     == srcAlpha
+            && slot.dstFmt       == dstFmt
+            && slot.dstAlpha     == dstAlpha
+            && slot.cpu          == cpu
+            && slot.same_profile == same_profile
+            && profiles_equal(srcProfile, &slot.xform->extras->src_profile,
+                              /*compare_A2B=*/true, /*compare_B2A=*/same_profile)
+            && (same_profile || profiles_equal(dstProfile, &slot.xform->extras->dst_profile,
+                                               /*compare_A2B=*/false, /*compare_B2A=*/true));
+    };
+
+    TransformCacheShard* shard = &transform_cache()[key % kTransformCacheShards];
+    skcms_CompiledTransform* xform = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        for (TransformCacheSlot& slot : shard->slots) {
+            if (matches(slot)) {
+                xform = slot.xform;
+                xform->refs++;
+                slot.last_used = ++shard->clock;
+                break;
+            }
+        }
+    }
+
+    if (xform) {
+        gTransformCacheHits++;
+    } else {
+        gTransformCacheMisses++;
+        if (!(xform = create_transform(srcFmt, srcAlpha, srcProfile,
+                                       dstFmt, dstAlpha, dstProfile,
+                                       skcms_Interpolation_Multilinear, cpu))) {
+            return false;
+        }
+        xform->refs.store(2);  // One for the cache, one for us.
+
+        std::lock_guard<std::mutex> guard(shard->lock);
+        TransformCacheSlot* victim = &shard->slots[0];
+        for (TransformCacheSlot& slot : shard->slots) {
+            if (matches(slot)) {
+                // Another thread compiled the same transform while we were.  Keep theirs.
+                victim = nullptr;
+                break;
+            }
+            if (!slot.xform) {
+                victim = &slot;
+            } else if (victim->xform && slot.last_used < victim->last_used) {
+                victim = &slot;
+            }
+        }
+        if (!victim) {
+            xform->refs--;
+        } else {
+            if (victim->xform) {
+                gTransformCacheEvictions++;
+                release_cached_transform(victim->xform);
+            }
+            victim->key          = key;
+            victim->srcFmt       = srcFmt;
+            victim->srcAlpha     = srcAlpha;
+            victim->dstFmt       = dstFmt;
+            victim->dstAlpha     = dstAlpha;
+            victim->cpu          = cpu;
+            victim->same_profile = same_profile;
+            victim->xform        = xform;
+            victim->last_used    = ++shard->clock;
+        }
+    }
+
+    bool ok = run_transform(xform, src, dst, npixels);
+    release_cached_transform(xform);
+    return ok;
+}
+
+skcms_TransformCacheStats skcms_GetTransformCacheStats() {
+    skcms_TransformCacheStats stats;
+    stats.hits      = gTransformCacheHits.load();
+    stats.misses    = gTransformCacheMisses.load();
+    stats.evictions = gTransformCacheEvictions.load();
+    return stats;
+}
+
+void skcms_PurgeTransformCache() {
+    TransformCacheShard* shards = transform_cache();
+    for (int i = 0; i < kTransformCacheShards; i++) {
+        TransformCacheShard& shard = shards[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (TransformCacheSlot& slot : shard.slots) {
+            if (slot.xform) {
+                release_cached_transform(slot.xform);
+                slot.xform = nullptr;
+            }
+        }
+    }
+}
+
 static void assert_usable_as_destination(const skcms_ICCProfile* profile) {
 #if defined(NDEBUG)
     (void)profile;
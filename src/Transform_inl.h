@@ -470,6 +470,28 @@ SI U16 gather_16(const uint8_t* p, I32 ix) {
     return v;
 }
 
+#if defined(USING_AVX2) || defined(USING_AVX512F)
+    SI U32 gather_32_bytes(const uint8_t* p, I32 off) {
+        // Load 32 bits from p at each byte offset with one hardware gather.
+        // The gather instruction here doesn't need any particular alignment,
+        // but the intrinsic takes a const int*.
+        const int* p4 = bit_pun<const int*>(p);
+    #if N == 8
+        I32 zero = { 0, 0, 0, 0,  0, 0, 0, 0},
+            mask = {-1,-1,-1,-1, -1,-1,-1,-1};
+        #if defined(__clang__)
+            return (U32)__builtin_ia32_gatherd_d256(zero, p4, off, mask, 1);
+        #elif defined(__GNUC__)
+            return (U32)__builtin_ia32_gathersiv8si(zero, p4, off, mask, 1);
+        #endif
+    #elif N == 16
+        // The intrinsic is supposed to take const void* now, but it takes const int*, like AVX2.
+        // And AVX-512 swapped the order of arguments.  :/
+        return (U32)_mm512_i32gather_epi32((__m512i)off, p4, 1);
+    #endif
+    }
+#endif
+
 SI U32 gather_32(const uint8_t* p, I32 ix) {
     // Load the i'th 32-bit value from p.
     auto load_32 = [p](int i) {
@@ -479,16 +501,13 @@ SI U32 gather_32(const uint8_t* p, I32 ix) {
     U32 v = load_32(ix);
 #elif N == 4
     U32 v = { load_32(ix[0]), load_32(ix[1]), load_32(ix[2]), load_32(ix[3]) };
-#elif N == 8
+#elif N == 8 && !defined(USING_AVX2)
     U32 v = { load_32(ix[0]), load_32(ix[1]), load_32(ix[2]), load_32(ix[3]),
               load_32(ix[4]), load_32(ix[5]), load_32(ix[6]), load_32(ix[7]) };
-#elif N == 16
-    U32 v = { load_32(ix[ 0]), load_32(ix[ 1]), load_32(ix[ 2]), load_32(ix[ 3]),
-              load_32(ix[ 4]), load_32(ix[ 5]), load_32(ix[ 6]), load_32(ix[ 7]),
-              load_32(ix[ 8]), load_32(ix[ 9]), load_32(ix[10]), load_32(ix[11]),
-              load_32(ix[12]), load_32(ix[13]), load_32(ix[14]), load_32(ix[15]) };
+#else
+    (void)load_32;
+    U32 v = gather_32_bytes(p, 4*ix);
 #endif
-    // TODO: AVX2 and AVX-512 gathers (c.f. gather_24).
     return v;
 }
 
@@ -506,24 +525,9 @@ SI U32 gather_24(const uint8_t* p, I32 ix) {
 #elif N == 8 && !defined(USING_AVX2)
     U32 v = { load_24_32(ix[0]), load_24_32(ix[1]), load_24_32(ix[2]), load_24_32(ix[3]),
               load_24_32(ix[4]), load_24_32(ix[5]), load_24_32(ix[6]), load_24_32(ix[7]) };
-#elif N == 8
-    (void)load_24_32;
-    // The gather instruction here doesn't need any particular alignment,
-    // but the intrinsic takes a const int*.
-    const int* p4 = bit_pun<const int*>(p);
-    I32 zero = { 0, 0, 0, 0,  0, 0, 0, 0},
-        mask = {-1,-1,-1,-1, -1,-1,-1,-1};
-    #if defined(__clang__)
-        U32 v = (U32)__builtin_ia32_gatherd_d256(zero, p4, 3*ix, mask, 1);
-    #elif defined(__GNUC__)
-        U32 v = (U32)__builtin_ia32_gathersiv8si(zero, p4, 3*ix, mask, 1);
-    #endif
-#elif N == 16
+#else
     (void)load_24_32;
-    // The intrinsic is supposed to take const void* now, but it takes const int*, just like AVX2.
-    // And AVX-512 swapped the order of arguments.  :/
-    const int* p4 = bit_pun<const int*>(p);
-    U32 v = (U32)_mm512_i32gather_epi32((__m512i)(3*ix), p4, 1);
+    U32 v = gather_32_bytes(p, 3*ix);
 #endif
 
     // Mask off the junk byte, leaving r,g,b in low 24 bits.
@@ -584,6 +588,56 @@ SI U32 gather_24(const uint8_t* p, I32 ix) {
 
         *v &= 0x0000FFFFFFFFFFFFULL;
     }
+
+    SI void gather_64(const uint8_t* p, I32 ix, U64* v) {
+        // Load the i'th 64-bit value from p.
+        auto load_64 = [p](int i) {
+            return load<uint64_t>(p + 8*i);
+        };
+
+    #if N == 1
+        *v = load_64(ix);
+    #elif N == 4
+        *v = U64{
+            load_64(ix[0]), load_64(ix[1]), load_64(ix[2]), load_64(ix[3]),
+        };
+    #elif N == 8 && !defined(USING_AVX2)
+        *v = U64{
+            load_64(ix[0]), load_64(ix[1]), load_64(ix[2]), load_64(ix[3]),
+            load_64(ix[4]), load_64(ix[5]), load_64(ix[6]), load_64(ix[7]),
+        };
+    #elif N == 8
+        (void)load_64;
+        typedef int32_t   __attribute__((vector_size(16))) Half_I32;
+        typedef long long __attribute__((vector_size(32))) Half_I64;
+
+        const long long int* p8 = bit_pun<const long long int*>(p);
+
+        Half_I64 zero = { 0, 0, 0, 0},
+                 mask = {-1,-1,-1,-1};
+
+        ix *= 8;
+        Half_I32 ix_lo = { ix[0], ix[1], ix[2], ix[3] },
+                 ix_hi = { ix[4], ix[5], ix[6], ix[7] };
+
+        #if defined(__clang__)
+            Half_I64 lo = (Half_I64)__builtin_ia32_gatherd_q256(zero, p8, ix_lo, mask, 1),
+                     hi = (Half_I64)__builtin_ia32_gatherd_q256(zero, p8, ix_hi, mask, 1);
+        #elif defined(__GNUC__)
+            Half_I64 lo = (Half_I64)__builtin_ia32_gathersiv4di(zero, p8, ix_lo, mask, 1),
+                     hi = (Half_I64)__builtin_ia32_gathersiv4di(zero, p8, ix_hi, mask, 1);
+        #endif
+        store((char*)v +  0, lo);
+        store((char*)v + 32, hi);
+    #elif N == 16
+        (void)load_64;
+        const long long int* p8 = bit_pun<const long long int*>(p);
+        __m512i lo = _mm512_i32gather_epi64(_mm512_extracti32x8_epi32((__m512i)(8*ix), 0), p8, 1),
+                hi = _mm512_i32gather_epi64(_mm512_extracti32x8_epi32((__m512i)(8*ix), 1), p8, 1);
+        store((char*)v +  0, lo);
+        store((char*)v + 64, hi);
+    #endif
+    }
 #endif
 
 SI F F_from_U8(U8 v) {
@@ -616,11 +670,31 @@ SI F table(const skcms_Curve* curve, F v) {
         hi = cast<I32>(minus_1_ulp(ix+1.0f));
     F t = ix - cast<F>(lo);  // i.e. the fractional part of ix.
 
-    // TODO: can we load l and h simultaneously?  Each entry in 'h' is either
-    // the same as in 'l' or adjacent.  We have a rough idea that's it'd always be safe
-    // to read adjacent entries and perhaps underflow the table by a byte or two
-    // (it'd be junk, but always safe to read).  Not sure how to lerp yet.
     F l,h;
+#if defined(USING_AVX2) || defined(USING_AVX512F)
+    // Each entry in h is either the same as in l or the next one, so a single 32-bit gather
+    // can fetch both.  We back the gather up near the end of the table so it never reads past it.
+    const int bytes = curve->table_8 ? 1 : 2,
+              last  = (int)curve->table_entries - 4/bytes;
+    if (last >= 0) {
+        const uint8_t* table = curve->table_8 ? curve->table_8 : curve->table_16;
+        I32 over  = lo - last,
+            start = lo - (over & (over > 0));
+
+        const uint32_t mask = curve->table_8 ? 0xff : 0xffff;
+        U32 pair = gather_32_bytes(table, start*bytes),
+            lw   = (pair >> (U32)((lo - start) * (8*bytes))) & mask,
+            hw   = (pair >> (U32)((hi - start) * (8*bytes))) & mask;
+        if (curve->table_8) {
+            l = cast<F>(lw) * (1/255.0f);
+            h = cast<F>(hw) * (1/255.0f);
+        } else {
+            l = F_from_U16_BE(cast<U16>(lw));
+            h = F_from_U16_BE(cast<U16>(hw));
+        }
+        return l + (h-l)*t;
+    }
+#endif
     if (curve->table_8) {
         l = F_from_U8(gather_8(curve->table_8, lo));
         h = F_from_U8(gather_8(curve->table_8, hi));
@@ -631,6 +705,64 @@ SI F table(const skcms_Curve* curve, F v) {
     return l + (h-l)*t;
 }
 
+// Load the i'th (entry, step to the next entry) pair of floats from a decoded table.
+SI void gather_pair(const float* pairs, I32 ix, F* v, F* d) {
+#if defined(__arm__)
+    *v = bit_pun<F>(gather_32((const uint8_t*)pairs, 2*ix+0));
+    *d = bit_pun<F>(gather_32((const uint8_t*)pairs, 2*ix+1));
+#else
+    U64 vd;
+    gather_64((const uint8_t*)pairs, ix, &vd);
+    *v = bit_pun<F>(cast<U32>(vd      ));
+    *d = bit_pun<F>(cast<U32>(vd >> 32));
+#endif
+}
+
+SI F table(const TableLUT* lut, F v) {
+    if (!lut->pairs) {
+        return table(lut->curve, v);
+    }
+    F ix = max_(F0, min_(v, F1)) * (float)(lut->curve->table_entries - 1);
+
+    I32 lo = cast<I32>(            ix      ),
+        hi = cast<I32>(minus_1_ulp(ix+1.0f));
+    F t = ix - cast<F>(lo);
+
+    // Where ix+1 rounds down to lo+1, table() lerps from entry lo to itself.  Match it.
+    F l,d;
+    gather_pair(lut->pairs, lo, &l, &d);
+    return l + d*if_then_else(hi == lo, F0, t);
+}
+
+// Look up vals[ix] in a SmallTable.  AVX-512 holds all 32 entries in two registers, and AVX2
+// the 16 entries skcms.cc allows it in two more; elsewhere we just gather.
+SI F gather_small(const float* vals, I32 ix) {
+#if defined(USING_AVX512F)
+    return (F)_mm512_permutex2var_ps(_mm512_loadu_ps(vals), (__m512i)ix,
+                                     _mm512_loadu_ps(vals+16));
+#elif defined(USING_AVX2)
+    // vpermps only reads the low 3 bits of each index, so we look in both halves and pick one.
+    F lo = (F)_mm256_permutevar8x32_ps(_mm256_loadu_ps(vals+0), (__m256i)ix),
+      hi = (F)_mm256_permutevar8x32_ps(_mm256_loadu_ps(vals+8), (__m256i)ix);
+    return if_then_else(ix < 8, lo, hi);
+#else
+    return bit_pun<F>(gather_32((const uint8_t*)vals, ix));
+#endif
+}
+
+// Just like table(), but with the entries already decoded.
+SI F table_small(const SmallTable* table, F v) {
+    F ix = max_(F0, min_(v, F1)) * table->scale;
+
+    I32 lo = cast<I32>(            ix      ),
+        hi = cast<I32>(minus_1_ulp(ix+1.0f));
+    F t = ix - cast<F>(lo);
+
+    F l = gather_small(table->vals, lo),
+      h = gather_small(table->vals, hi);
+    return l + (h-l)*t;
+}
+
 SI void sample_clut_8(const uint8_t* grid_8, I32 ix, F* r, F* g, F* b) {
     U32 rgb = gather_24(grid_8, ix);
 
@@ -640,7 +772,6 @@ SI void sample_clut_8(const uint8_t* grid_8, I32 ix, F* r, F* g, F* b) {
 }
 
 SI void sample_clut_8(const uint8_t* grid_8, I32 ix, F* r, F* g, F* b, F* a) {
-    // TODO: don't forget to optimize gather_32().
     U32 rgba = gather_32(grid_8, ix);
 
     *r = cast<F>((rgba >>  0) & 0xff) * (1/255.0f);
@@ -668,18 +799,115 @@ SI void sample_clut_16(const uint8_t* grid_16, I32 ix, F* r, F* g, F* b) {
 }
 
 SI void sample_clut_16(const uint8_t* grid_16, I32 ix, F* r, F* g, F* b, F* a) {
-    // TODO: gather_64()-based fast path?
+#if defined(__arm__) || defined(__loongarch_sx)
     *r = F_from_U16_BE(gather_16(grid_16, 4*ix+0));
     *g = F_from_U16_BE(gather_16(grid_16, 4*ix+1));
     *b = F_from_U16_BE(gather_16(grid_16, 4*ix+2));
     *a = F_from_U16_BE(gather_16(grid_16, 4*ix+3));
+#else
+    // Like the 3-channel path above, load all four channels of each entry at once.
+    U64 rgba;
+    gather_64(grid_16, ix, &rgba);
+    rgba = swap_endian_16x4(rgba);
+
+    *r = cast<F>((rgba >>  0) & 0xffff) * (1/65535.0f);
+    *g = cast<F>((rgba >> 16) & 0xffff) * (1/65535.0f);
+    *b = cast<F>((rgba >> 32) & 0xffff) * (1/65535.0f);
+    *a = cast<F>((rgba >> 48)         ) * (1/65535.0f);
+#endif
+}
+
+SI void sample_clut_packed(const uint8_t* packed, bool is_8bit, I32 ix,
+                           F* r, F* g, F* b, F* a) {
+    // Each entry is aligned and already in native order, so one load finds all four channels.
+    if (is_8bit) {
+        sample_clut_8(packed, ix, r,g,b,a);
+        return;
+    }
+#if defined(__arm__)
+    *r = cast<F>(gather_16(packed, 4*ix+0)) * (1/65535.0f);
+    *g = cast<F>(gather_16(packed, 4*ix+1)) * (1/65535.0f);
+    *b = cast<F>(gather_16(packed, 4*ix+2)) * (1/65535.0f);
+    *a = cast<F>(gather_16(packed, 4*ix+3)) * (1/65535.0f);
+#else
+    U64 rgba;
+    gather_64(packed, ix, &rgba);
+
+    *r = cast<F>((rgba >>  0) & 0xffff) * (1/65535.0f);
+    *g = cast<F>((rgba >> 16) & 0xffff) * (1/65535.0f);
+    *b = cast<F>((rgba >> 32) & 0xffff) * (1/65535.0f);
+    *a = cast<F>((rgba >> 48)         ) * (1/65535.0f);
+#endif
+}
+
+SI void sample_clut(const CLUT* lut, I32 ix, F* r, F* g, F* b, F* a) {
+    const uint32_t output_channels = lut->output_channels;
+    const uint8_t* grid_8  = lut->grid_8;
+    const uint8_t* grid_16 = lut->grid_16;
+
+    if (lut->packed) {
+        sample_clut_packed(lut->packed, grid_8 != nullptr, ix, r,g,b,a);
+    } else if (output_channels == 3) {
+        if (grid_8) { sample_clut_8 (grid_8 ,ix, r,g,b); }
+        else        { sample_clut_16(grid_16,ix, r,g,b); }
+    } else {
+        if (grid_8) { sample_clut_8 (grid_8 ,ix, r,g,b,a); }
+        else        { sample_clut_16(grid_16,ix, r,g,b,a); }
+    }
 }
 
-static void clut(uint32_t input_channels, uint32_t output_channels,
-                 const uint8_t grid_points[4], const uint8_t* grid_8, const uint8_t* grid_16,
-                 F* r, F* g, F* b, F* a) {
+// Where grid coordinate c along dimension i of lut lies, in entries from the start of its grid,
+// when dimensions after i span stride entries in the ICC layout.  Blocked grids instead find
+// the block holding c and interleave the low kCLUTBlockBits bits of c with the other dimensions'.
+// Either way, the offsets of each dimension just add up to the index of an entry.
+SI I32 clut_offset(const CLUT* lut, int i, I32 c, int stride) {
+    if (!lut->blocked) {
+        return c * stride;
+    }
+    const int dim = (int)lut->input_channels;
+    I32 offset = (c >> kCLUTBlockBits) * lut->block_strides[i];
+    for (int l = 0; l < kCLUTBlockBits; l++) {
+        offset += ((c >> l) & 1) << (l*dim + dim-1-i);
+    }
+    return offset;
+}
+
+// Find where v lands along a grid dimension of the given number of points: between the integer
+// grid points lo and hi, t of the way from lo to hi.  hi stays put at lo on the top edge.
+SI void grid_cell(F v, int points, I32* lo, I32* hi, F* t) {
+    // x is where we logically want to sample the grid in this dimension.
+    // We MUST clamp to [0,1] here to avoid negative indices.
+    F x = max_(F0, min_(v, F1)) * (float)(points - 1);
+
+    // But we can't index at floats.  lo and hi are the two integer grid points surrounding x.
+    *lo = cast<I32>(            x      );   // i.e. trunc(x) == floor(x) here.
+    *hi = cast<I32>(minus_1_ulp(x+1.0f));
+
+    // We'll interpolate between those two integer grid points by t.
+    *t = x - cast<F>(*lo);  // i.e. fract(x)
+}
+
+// Sort the first dim dimensions by descending t, moving each's step along with it, with at
+// most 6 compare-and-swaps for CMYK.  A simplex (a tetrahedron for RGB) walks from the low
+// corner of its grid cell to the high corner, stepping along one dimension at a time in order.
+SI void sort_simplex(F t[], I32 step[], int dim) {
+    for (int pass = 0; pass < dim-1; pass++)
+    for (int i = 0; i < dim-1-pass; i++) {
+        I32 swap = t[i] < t[i+1];
+        F   t_lo = if_then_else(swap, t[i+1], t[i]),
+            t_hi = if_then_else(swap, t[i], t[i+1]);
+        I32 s_lo = if_then_else(swap, step[i+1], step[i]),
+            s_hi = if_then_else(swap, step[i], step[i+1]);
+        t   [i] = t_lo;  t   [i+1] = t_hi;
+        step[i] = s_lo;  step[i+1] = s_hi;
+    }
+}
+
+static void clut(const CLUT* lut, F* r, F* g, F* b, F* a) {
+    const uint32_t output_channels = lut->output_channels;
+    const uint8_t* grid_points     = lut->grid_points;
 
-    const int dim = (int)input_channels;
+    const int dim = (int)lut->input_channels;
     if (dim <= 0 || dim > 4) {
         return;
     }
@@ -693,20 +921,15 @@ static void clut(uint32_t input_channels, uint32_t output_channels,
     // O(dim) work first: calculate index,weight from r,g,b,a.
     const F inputs[] = { *r,*g,*b,*a };
     for (int i = dim-1, stride = 1; i >= 0; i--) {
-        // x is where we logically want to sample the grid in the i-th dimension.
-        // We MUST clamp to [0,1] here to avoid negative indices.
-        F x = max_(F0, min_(inputs[i], F1)) * (float)(grid_points[i] - 1);
+        I32 lo, hi;
+        F   t;
+        grid_cell(inputs[i], grid_points[i], &lo, &hi, &t);
 
-        // But we can't index at floats.  lo and hi are the two integer grid points surrounding x.
-        I32 lo = cast<I32>(            x      ),   // i.e. trunc(x) == floor(x) here.
-            hi = cast<I32>(minus_1_ulp(x+1.0f));
         // Notice how we fold in the accumulated stride across previous dimensions here.
-        index[i+0] = lo * stride;
-        index[i+4] = hi * stride;
+        index[i+0] = clut_offset(lut, i, lo, stride);
+        index[i+4] = clut_offset(lut, i, hi, stride);
         stride *= grid_points[i];
 
-        // We'll interpolate between those two integer grid points by t.
-        F t = x - cast<F>(lo);  // i.e. fract(x)
         weight[i+0] = 1-t;
         weight[i+4] = t;
     }
@@ -745,13 +968,7 @@ static void clut(uint32_t input_channels, uint32_t output_channels,
         }
 
         F R,G,B,A=F0;
-        if (output_channels == 3) {
-            if (grid_8) { sample_clut_8 (grid_8 ,ix, &R,&G,&B); }
-            else        { sample_clut_16(grid_16,ix, &R,&G,&B); }
-        } else {
-            if (grid_8) { sample_clut_8 (grid_8 ,ix, &R,&G,&B,&A); }
-            else        { sample_clut_16(grid_16,ix, &R,&G,&B,&A); }
-        }
+        sample_clut(lut, ix, &R,&G,&B,&A);
         *r += w*R;
         *g += w*G;
         *b += w*B;
@@ -759,15 +976,98 @@ static void clut(uint32_t input_channels, uint32_t output_channels,
     }
 }
 
-static void clut(const skcms_A2B* a2b, F* r, F* g, F* b, F a) {
-    clut(a2b->input_channels, a2b->output_channels,
-         a2b->grid_points, a2b->grid_8, a2b->grid_16,
-         r,g,b,&a);
+// Simplex interpolation splits each grid cell into dim! simplices (tetrahedra for RGB, pentatopes
+// for CMYK) and blends just the dim+1 corners of the one holding the input, not all 2^dim.
+static void clut_simplex(const CLUT* lut, F* r, F* g, F* b, F* a) {
+    const uint32_t output_channels = lut->output_channels;
+    const uint8_t* grid_points     = lut->grid_points;
+
+    const int dim = (int)lut->input_channels;
+    if (dim <= 0 || dim > 4) {
+        return;
+    }
+    assert (output_channels == 3 ||
+            output_channels == 4);
+
+    // As in clut(), find the low corner of the cell and how far along each dimension we are,
+    // noting in step[] the index change to move to the high side of the cell in each dimension.
+    I32 base = cast<I32>(F0);
+    I32 step[4];
+    F   t   [4];
+    const F inputs[] = { *r,*g,*b,*a };
+    for (int i = dim-1, stride = 1; i >= 0; i--) {
+        I32 lo, hi;
+        grid_cell(inputs[i], grid_points[i], &lo, &hi, &t[i]);
+        I32 off = clut_offset(lut, i, lo, stride);
+        base   += off;
+        step[i] = clut_offset(lut, i, hi, stride) - off;
+        stride *= grid_points[i];
+    }
+    sort_simplex(t, step, dim);
+
+    // Each corner k of the simplex is weighted by t[k-1] - t[k], counting t[-1] as 1 and t[dim]
+    // as 0.
+    *r = *g = *b = F0;
+    if (output_channels == 4) {
+        *a = F0;
+    }
+    I32 ix   = base;
+    F   prev = F1;
+    for (int k = 0; k <= dim; k++) {
+        F next = k < dim ? t[k] : F0,
+          w    = prev - next;
+
+        F R,G,B,A=F0;
+        sample_clut(lut, ix, &R,&G,&B,&A);
+        *r += w*R;
+        *g += w*G;
+        *b += w*B;
+        *a += w*A;
+
+        if (k < dim) {
+            ix  += step[k];
+            prev = next;
+        }
+    }
 }
-static void clut(const skcms_B2A* b2a, F* r, F* g, F* b, F* a) {
-    clut(b2a->input_channels, b2a->output_channels,
-         b2a->grid_points, b2a->grid_8, b2a->grid_16,
-         r,g,b,a);
+
+// Sample a BakedLUT at r,g,b by tetrahedral interpolation: of the six tetrahedra splitting
+// each cube of the grid, find the one holding r,g,b and blend its 4 corners, rather than all 8.
+SI void tetrahedral(const BakedLUT* lut, F* r, F* g, F* b) {
+    const int points = lut->grid_points;
+
+    // As in clut_simplex(), we track the low corner and the step along each dimension, here as
+    // offsets in floats into the table.
+    const F inputs[] = { *r,*g,*b };
+    I32 base = cast<I32>(F0);
+    F   t[3];
+    I32 step[3];
+    for (int d = 0, stride = 3*points*points; d < 3; d++, stride /= points) {
+        I32 lo, hi;
+        grid_cell(inputs[d], points, &lo, &hi, &t[d]);
+        step[d] = (hi - lo) * stride;
+        base   += lo * stride;
+    }
+    sort_simplex(t, step, 3);
+
+    const I32 corner[4] = {
+        base,
+        base + step[0],
+        base + step[0] + step[1],
+        base + step[0] + step[1] + step[2],
+    };
+    const F weight[4] = { 1 - t[0], t[0] - t[1], t[1] - t[2], t[2] };
+
+    const uint8_t* table = (const uint8_t*)lut->table;
+    F R = F0, G = F0, B = F0;
+    for (int c = 0; c < 4; c++) {
+        R += weight[c] * bit_pun<F>(gather_32(table, corner[c] + 0));
+        G += weight[c] * bit_pun<F>(gather_32(table, corner[c] + 1));
+        B += weight[c] * bit_pun<F>(gather_32(table, corner[c] + 2));
+    }
+    *r = R;
+    *g = G;
+    *b = B;
 }
 
 struct NoCtx {};
@@ -817,6 +1117,24 @@ struct Ctx {
     #define FINAL_STAGE(name, arg) \
         DECLARE_STAGE(name, arg, /* Stop executing stages and return to the caller. */)
 
+    #define DECLARE_FUSED_STAGE(name, count, CALL_NEXT)                         \
+        SI void Exec_##name##_k(const void** ctx, STAGE_PARAMS(&));             \
+                                                                                \
+        SI void Exec_##name(StageList list, const void** ctx, STAGE_PARAMS()) { \
+            Exec_##name##_k(ctx, src, dst, r, g, b, a, i);                      \
+            ++list.fn; ctx += count;                                            \
+            CALL_NEXT;                                                          \
+        }                                                                       \
+                                                                                \
+        SI void Exec_##name##_k(const void** ctx, STAGE_PARAMS(&))
+
+    #define FUSED_STAGE(name, count)                                                       \
+        DECLARE_FUSED_STAGE(name, count, [[clang::musttail]] return (*list.fn)(list, ctx,  \
+                                                                    src, dst, r, g, b, a, i))
+
+    #define FINAL_FUSED_STAGE(name, count) \
+        DECLARE_FUSED_STAGE(name, count, /* Stop executing stages and return to the caller. */)
+
 #else
 
     #define DECLARE_STAGE(name, arg)                            \
@@ -831,8 +1149,17 @@ struct Ctx {
     #define STAGE(name, arg)       DECLARE_STAGE(name, arg)
     #define FINAL_STAGE(name, arg) DECLARE_STAGE(name, arg)
 
+    #define DECLARE_FUSED_STAGE(name) \
+        SI void Exec_##name(const void** ctx, STAGE_PARAMS(&))
+
+    #define FUSED_STAGE(name, count)       DECLARE_FUSED_STAGE(name)
+    #define FINAL_FUSED_STAGE(name, count) DECLARE_FUSED_STAGE(name)
+
 #endif
 
+// Fused stages run the bodies of the stages they replace, k counting from 0 for the first.
+#define FUSE(name, k) Exec_##name##_k(Ctx{ctx[k]}, src, dst, r, g, b, a, i)
+
 STAGE(load_a8, NoCtx) {
     a = F_from_U8(load<U8>(src + 1*i));
 }
@@ -1075,6 +1402,119 @@ STAGE(load_ffff, NoCtx) {
 #endif
 }
 
+// Planar loads and stores find their planes through the skcms_PlanarBuffer at src or dst.
+SI F load_plane_8 (const void* plane, int i) {
+    return F_from_U8(load<U8>((const uint8_t*)plane + i));
+}
+SI F load_plane_16(const void* plane, int i) {
+    return cast<F>(load<U16>((const uint16_t*)plane + i)) * (1/65535.0f);
+}
+SI F load_plane_h (const void* plane, int i) {
+    return F_from_Half(load<U16>((const uint16_t*)plane + i));
+}
+SI F load_plane_f (const void* plane, int i) {
+    return load<F>((const float*)plane + i);
+}
+
+STAGE(load_planar_888, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_8(p.planes[0], i);
+    g = load_plane_8(p.planes[1], i);
+    b = load_plane_8(p.planes[2], i);
+}
+
+STAGE(load_planar_8888, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_8(p.planes[0], i);
+    g = load_plane_8(p.planes[1], i);
+    b = load_plane_8(p.planes[2], i);
+    a = load_plane_8(p.planes[3], i);
+}
+
+STAGE(load_planar_161616, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_16(p.planes[0], i);
+    g = load_plane_16(p.planes[1], i);
+    b = load_plane_16(p.planes[2], i);
+}
+
+STAGE(load_planar_16161616, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_16(p.planes[0], i);
+    g = load_plane_16(p.planes[1], i);
+    b = load_plane_16(p.planes[2], i);
+    a = load_plane_16(p.planes[3], i);
+}
+
+STAGE(load_planar_hhh, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_h(p.planes[0], i);
+    g = load_plane_h(p.planes[1], i);
+    b = load_plane_h(p.planes[2], i);
+}
+
+STAGE(load_planar_hhhh, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_h(p.planes[0], i);
+    g = load_plane_h(p.planes[1], i);
+    b = load_plane_h(p.planes[2], i);
+    a = load_plane_h(p.planes[3], i);
+}
+
+STAGE(load_planar_fff, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_f(p.planes[0], i);
+    g = load_plane_f(p.planes[1], i);
+    b = load_plane_f(p.planes[2], i);
+}
+
+STAGE(load_planar_ffff, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    r = load_plane_f(p.planes[0], i);
+    g = load_plane_f(p.planes[1], i);
+    b = load_plane_f(p.planes[2], i);
+    a = load_plane_f(p.planes[3], i);
+}
+
+// Subsampled YCbCr loads leave Y, Cb, and Cr in r, g, and b, for a matrix_3x4 to convert to RGB.
+// Each pair of pixels shares the chroma sample at half its index.
+SI I32 chroma_index(int i) {
+#if N == 1
+    I32 lane = 0;
+#elif N == 4
+    I32 lane = { 0,1,2,3 };
+#elif N == 8
+    I32 lane = { 0,1,2,3, 4,5,6,7 };
+#elif N == 16
+    I32 lane = { 0,1,2,3, 4,5,6,7, 8,9,10,11, 12,13,14,15 };
+#endif
+    return (lane + i) >> 1;
+}
+
+STAGE(load_ycbcr_h2_888, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    I32 ix = chroma_index(i);
+    r = load_plane_8(p.planes[0], i);
+    g = F_from_U8(gather_8((const uint8_t*)p.planes[1], ix));
+    b = F_from_U8(gather_8((const uint8_t*)p.planes[2], ix));
+}
+
+STAGE(load_ycbcr_h2_semi_8, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    U16 cbcr = gather_16((const uint8_t*)p.planes[1], chroma_index(i));
+    r = load_plane_8(p.planes[0], i);
+    g = cast<F>((cbcr >> 0) & 0xff) * (1/255.0f);
+    b = cast<F>((cbcr >> 8) & 0xff) * (1/255.0f);
+}
+
+STAGE(load_ycbcr_h2_semi_16, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(src);
+    U32 cbcr = gather_32((const uint8_t*)p.planes[1], chroma_index(i));
+    r = load_plane_16(p.planes[0], i);
+    g = cast<F>((cbcr >>  0) & 0xffff) * (1/65535.0f);
+    b = cast<F>((cbcr >> 16) & 0xffff) * (1/65535.0f);
+}
+
 STAGE(swap_rb, NoCtx) {
     F t = r;
     r = b;
@@ -1268,13 +1708,20 @@ STAGE(hlginv_ootf_scale, const void*) {
     b = b * Y_to_gamma_minus1;
 }
 
-STAGE(table_r, const skcms_Curve* curve) { r = table(curve, r); }
-STAGE(table_g, const skcms_Curve* curve) { g = table(curve, g); }
-STAGE(table_b, const skcms_Curve* curve) { b = table(curve, b); }
-STAGE(table_a, const skcms_Curve* curve) { a = table(curve, a); }
+STAGE(table_r, const TableLUT* lut) { r = table(lut, r); }
+STAGE(table_g, const TableLUT* lut) { g = table(lut, g); }
+STAGE(table_b, const TableLUT* lut) { b = table(lut, b); }
+STAGE(table_a, const TableLUT* lut) { a = table(lut, a); }
+
+STAGE(table_small_r, const SmallTable* table) { r = table_small(table, r); }
+STAGE(table_small_g, const SmallTable* table) { g = table_small(table, g); }
+STAGE(table_small_b, const SmallTable* table) { b = table_small(table, b); }
+STAGE(table_small_a, const SmallTable* table) { a = table_small(table, a); }
 
-STAGE(clut_A2B, const skcms_A2B* a2b) {
-    clut(a2b, &r,&g,&b,a);
+STAGE(clut_A2B, const CLUT* a2b) {
+    // A2B CLUTs have 3 outputs, leaving alpha alone.
+    F A = a;
+    clut(a2b, &r,&g,&b,&A);
 
     if (a2b->input_channels == 4) {
         // CMYK is opaque.
@@ -1282,10 +1729,28 @@ STAGE(clut_A2B, const skcms_A2B* a2b) {
     }
 }
 
-STAGE(clut_B2A, const skcms_B2A* b2a) {
+STAGE(clut_B2A, const CLUT* b2a) {
     clut(b2a, &r,&g,&b,&a);
 }
 
+STAGE(clut_A2B_simplex, const CLUT* a2b) {
+    F A = a;
+    clut_simplex(a2b, &r,&g,&b,&A);
+
+    if (a2b->input_channels == 4) {
+        // CMYK is opaque.
+        a = F1;
+    }
+}
+
+STAGE(clut_B2A_simplex, const CLUT* b2a) {
+    clut_simplex(b2a, &r,&g,&b,&a);
+}
+
+STAGE(baked_lut, const BakedLUT* lut) {
+    tetrahedral(lut, &r,&g,&b);
+}
+
 // From here on down, the store_ ops are all "final stages," terminating processing of this group.
 
 FINAL_STAGE(store_a8, NoCtx) {
@@ -1534,12 +1999,164 @@ FINAL_STAGE(store_ffff, NoCtx) {
 #endif
 }
 
+SI void store_plane_8 (void* plane, int i, F v) {
+    store((uint8_t*)plane + i, cast<U8>(to_fixed(v * 255)));
+}
+SI void store_plane_16(void* plane, int i, F v) {
+    store((uint16_t*)plane + i, cast<U16>(to_fixed(v * 65535)));
+}
+SI void store_plane_h (void* plane, int i, F v) {
+    store((uint16_t*)plane + i, Half_from_F(v));
+}
+SI void store_plane_f (void* plane, int i, F v) {
+    store((float*)plane + i, v);
+}
+
+FINAL_STAGE(store_planar_888, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_8(p.planes[0], i, r);
+    store_plane_8(p.planes[1], i, g);
+    store_plane_8(p.planes[2], i, b);
+}
+
+FINAL_STAGE(store_planar_8888, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_8(p.planes[0], i, r);
+    store_plane_8(p.planes[1], i, g);
+    store_plane_8(p.planes[2], i, b);
+    store_plane_8(p.planes[3], i, a);
+}
+
+FINAL_STAGE(store_planar_161616, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_16(p.planes[0], i, r);
+    store_plane_16(p.planes[1], i, g);
+    store_plane_16(p.planes[2], i, b);
+}
+
+FINAL_STAGE(store_planar_16161616, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_16(p.planes[0], i, r);
+    store_plane_16(p.planes[1], i, g);
+    store_plane_16(p.planes[2], i, b);
+    store_plane_16(p.planes[3], i, a);
+}
+
+FINAL_STAGE(store_planar_hhh, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_h(p.planes[0], i, r);
+    store_plane_h(p.planes[1], i, g);
+    store_plane_h(p.planes[2], i, b);
+}
+
+FINAL_STAGE(store_planar_hhhh, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_h(p.planes[0], i, r);
+    store_plane_h(p.planes[1], i, g);
+    store_plane_h(p.planes[2], i, b);
+    store_plane_h(p.planes[3], i, a);
+}
+
+FINAL_STAGE(store_planar_fff, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_f(p.planes[0], i, r);
+    store_plane_f(p.planes[1], i, g);
+    store_plane_f(p.planes[2], i, b);
+}
+
+FINAL_STAGE(store_planar_ffff, NoCtx) {
+    skcms_PlanarBuffer p = load<skcms_PlanarBuffer>(dst);
+    store_plane_f(p.planes[0], i, r);
+    store_plane_f(p.planes[1], i, g);
+    store_plane_f(p.planes[2], i, b);
+    store_plane_f(p.planes[3], i, a);
+}
+
+FUSED_STAGE(load_8888_tf_rgb, 2) {
+    FUSE(load_8888, 0);
+    FUSE(tf_rgb,    1);
+}
+
+FUSED_STAGE(matrix_3x3_tf_rgb, 2) {
+    FUSE(matrix_3x3, 0);
+    FUSE(tf_rgb,     1);
+}
+
+FINAL_FUSED_STAGE(tf_rgb_clamp_store_8888, 3) {
+    FUSE(tf_rgb,     0);
+    FUSE(clamp,      1);
+    FUSE(store_8888, 2);
+}
+
+FINAL_FUSED_STAGE(premul_store_8888, 2) {
+    FUSE(premul,     0);
+    FUSE(store_8888, 1);
+}
+
+#undef FUSE
+
 #if SKCMS_HAS_MUSTTAIL
 
     SI void exec_stages(StageFn* stages, const void** contexts, const char* src, char* dst, int i) {
         (*stages)({stages}, contexts, src, dst, F0, F0, F0, F1, i);
     }
 
+#elif defined(SKCMS_PROFILE)
+
+    // Each op runs through a function pointer, so that the compiler can't blend it into its
+    // neighbors or move its work across our clock reads.
+    using ProfiledStageFn = void (*)(const void** ctx, STAGE_PARAMS(&));
+
+#define M(name)                                                        \
+    static void Profiled_##name(const void** ctx, STAGE_PARAMS(&)) {   \
+        Exec_##name(*ctx, src, dst, r, g, b, a, i);                    \
+    }
+    SKCMS_WORK_OPS(M)
+    SKCMS_STORE_OPS(M)
+#undef M
+#define M(name, count)                                                 \
+    static void Profiled_##name(const void** ctx, STAGE_PARAMS(&)) {   \
+        Exec_##name(ctx, src, dst, r, g, b, a, i);                     \
+    }
+    SKCMS_FUSED_WORK_OPS(M)
+    SKCMS_FUSED_STORE_OPS(M)
+#undef M
+
+    static void exec_stages(const Op* ops, const void** contexts,
+                            const char* src, char* dst, int i) {
+        static const struct {
+            ProfiledStageFn fn;
+            int             contexts;
+            bool            store;
+        } kStages[] = {
+#define M(name) { &Profiled_##name, 1, false },
+            SKCMS_WORK_OPS(M)
+#undef M
+#define M(name) { &Profiled_##name, 1, true },
+            SKCMS_STORE_OPS(M)
+#undef M
+#define M(name, count) { &Profiled_##name, count, false },
+            SKCMS_FUSED_WORK_OPS(M)
+#undef M
+#define M(name, count) { &Profiled_##name, count, true },
+            SKCMS_FUSED_STORE_OPS(M)
+#undef M
+        };
+
+        F r = F0, g = F0, b = F0, a = F1;
+        while (true) {
+            const Op op = *ops++;
+            const uint64_t start = profile_ticks();
+            kStages[(int)op].fn(contexts, src, dst, r, g, b, a, i);
+            record_stage(op, profile_ticks() - start);
+
+            if (kStages[(int)op].store) {
+                return;
+            }
+            contexts += kStages[(int)op].contexts;
+        }
+    }
+
 #else
 
     static void exec_stages(const Op* ops, const void** contexts,
@@ -1552,6 +2169,13 @@ FINAL_STAGE(store_ffff, NoCtx) {
 #undef M
 #define M(name) case Op::name: Exec_##name(*contexts++, src, dst, r, g, b, a, i); return;
                 SKCMS_STORE_OPS(M)
+#undef M
+#define M(name, count) case Op::name: Exec_##name(contexts, src, dst, r, g, b, a, i); \
+                                      contexts += count; break;
+                SKCMS_FUSED_WORK_OPS(M)
+#undef M
+#define M(name, count) case Op::name: Exec_##name(contexts, src, dst, r, g, b, a, i); return;
+                SKCMS_FUSED_STORE_OPS(M)
 #undef M
             }
         }
@@ -1560,7 +2184,7 @@ FINAL_STAGE(store_ffff, NoCtx) {
 #endif
 
 // NOLINTNEXTLINE(misc-definitions-in-headers)
-void run_program(const Op* program, const void** contexts, SKCMS_MAYBE_UNUSED ptrdiff_t programSize,
+void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
                  const char* src, char* dst, int n,
                 size_t src_bpp, size_t dst_bpp) {
 #if SKCMS_HAS_MUSTTAIL
@@ -1572,6 +2196,10 @@ void run_program(const Op* program, const void** contexts, SKCMS_MAYBE_UNUSED pt
 #define M(name) &Exec_##name,
         SKCMS_WORK_OPS(M)
         SKCMS_STORE_OPS(M)
+#undef M
+#define M(name, count) &Exec_##name,
+        SKCMS_FUSED_WORK_OPS(M)
+        SKCMS_FUSED_STORE_OPS(M)
 #undef M
     };
 
@@ -1592,8 +2220,501 @@ void run_program(const Op* program, const void** contexts, SKCMS_MAYBE_UNUSED pt
     if (n > 0) {
         char tmp[4*4*N] = {0};
 
-        memcpy(tmp, (const char*)src + (size_t)i*src_bpp, (size_t)n*src_bpp);
-        exec_stages(stages, contexts, tmp, tmp, 0);
-        memcpy((char*)dst + (size_t)i*dst_bpp, tmp, (size_t)n*dst_bpp);
+        // Planar formats get a quarter of tmp for each plane, room for N floats each.
+        // i is a multiple of N here, so subsampled planes' tails start at a whole sample.
+        const PlanarLayout src_layout = planar_layout(program[0]),
+                           dst_layout = planar_layout(program[programSize-1]);
+        skcms_PlanarBuffer src_tmp, dst_tmp, planes;
+        const char* tail_src = tmp;
+        char*       tail_dst = tmp;
+
+        if (src_layout.planes) {
+            planes = load<skcms_PlanarBuffer>(src);
+            for (int p = 0; p < src_layout.planes; p++) {
+                const int    shift = src_layout.shift[p];
+                const size_t bytes = src_layout.bytes[p];
+                src_tmp.planes[p] = tmp + p*4*N;
+                memcpy(src_tmp.planes[p], (const char*)planes.planes[p] + (size_t)(i>>shift)*bytes,
+                       (size_t)((n + (1<<shift) - 1) >> shift)*bytes);
+            }
+            tail_src = (const char*)&src_tmp;
+        } else {
+            memcpy(tmp, (const char*)src + (size_t)i*src_bpp, (size_t)n*src_bpp);
+        }
+        if (dst_layout.planes) {
+            for (int p = 0; p < dst_layout.planes; p++) {
+                dst_tmp.planes[p] = tmp + p*4*N;
+            }
+            tail_dst = (char*)&dst_tmp;
+        }
+
+        exec_stages(stages, contexts, tail_src, tail_dst, 0);
+
+        if (dst_layout.planes) {
+            planes = load<skcms_PlanarBuffer>(dst);
+            for (int p = 0; p < dst_layout.planes; p++) {
+                memcpy((char*)planes.planes[p] + (size_t)i*dst_layout.bytes[p], dst_tmp.planes[p],
+                       (size_t)n*dst_layout.bytes[p]);
+            }
+        } else {
+            memcpy((char*)dst + (size_t)i*dst_bpp, tmp, (size_t)n*dst_bpp);
+        }
+    }
+}
+
+// ~~~~ Specialized kernels ~~~~ //
+
+// A handful of programs account for most transforms we run.  For those we instantiate a kernel
+// that runs the program's stage bodies back to back, fully inlined with no dispatch between them.
+
+template <Op op> struct Stage;
+#define M(name)                                                                  \
+    template <> struct Stage<Op::name> {                                         \
+        SI void exec(const void* ctx, STAGE_PARAMS(&)) {                         \
+            Exec_##name##_k(Ctx{ctx}, src, dst, r, g, b, a, i);                  \
+        }                                                                        \
+    };
+SKCMS_WORK_OPS(M)
+SKCMS_STORE_OPS(M)
+#undef M
+
+template <Op... ops> struct OpList {};
+
+template <Op... ops>
+constexpr int count_ops(OpList<ops...>) { return sizeof...(ops); }
+
+SI void exec_kernel(OpList<>, const void**, STAGE_PARAMS(&)) {}
+
+template <Op op, Op... rest>
+SI void exec_kernel(OpList<op, rest...>, const void** contexts, STAGE_PARAMS(&)) {
+    Stage<op>::exec(*contexts, src, dst, r, g, b, a, i);
+    exec_kernel(OpList<rest...>{}, contexts + 1, src, dst, r, g, b, a, i);
+}
+
+template <Op... ops>
+SI void exec_kernel(const void** contexts, const char* src, char* dst, int i) {
+    F r = F0, g = F0, b = F0, a = F1;
+    exec_kernel(OpList<ops...>{}, contexts, src, dst, r, g, b, a, i);
+}
+
+// Kernels only run interleaved formats, so unlike run_program() their tails need no planes.
+template <Op... ops>
+static void run_kernel(const Op*, const void** contexts, ptrdiff_t,
+                       const char* src, char* dst, int n,
+                       size_t src_bpp, size_t dst_bpp) {
+    int i = 0;
+    while (n >= N) {
+        exec_kernel<ops...>(contexts, src, dst, i);
+        i += N;
+        n -= N;
+    }
+    if (n > 0) {
+        char tmp[4*4*N] = {0};
+
+        memcpy(tmp, src + (size_t)i*src_bpp, (size_t)n*src_bpp);
+        exec_kernel<ops...>(contexts, tmp, tmp, 0);
+        memcpy(dst + (size_t)i*dst_bpp, tmp, (size_t)n*dst_bpp);
+    }
+}
+
+struct Kernel {
+    RunProgramFn run;
+    int          count;
+    Op           program[8];
+};
+
+#define KERNEL(...) { run_kernel<__VA_ARGS__>, count_ops(OpList<__VA_ARGS__>{}), { __VA_ARGS__ } }
+
+static const Kernel kKernels[] = {
+    // sRGB <-> Display P3, 8888 with unpremul, premul, and opaque alpha.
+    KERNEL(Op::load_8888, Op::tf_rgb, Op::matrix_3x3, Op::tf_rgb, Op::clamp, Op::store_8888),
+    KERNEL(Op::load_8888, Op::unpremul, Op::tf_rgb, Op::matrix_3x3, Op::tf_rgb, Op::clamp,
+           Op::premul, Op::store_8888),
+    KERNEL(Op::load_8888, Op::force_opaque, Op::tf_rgb, Op::matrix_3x3, Op::tf_rgb, Op::clamp,
+           Op::store_8888),
+
+    // sRGB 8888 to linear half float.
+    KERNEL(Op::load_8888, Op::tf_rgb, Op::store_hhhh),
+    KERNEL(Op::load_8888, Op::force_opaque, Op::tf_rgb, Op::store_hhhh),
+    KERNEL(Op::load_8888, Op::tf_rgb, Op::premul, Op::store_hhhh),
+    KERNEL(Op::load_8888, Op::unpremul, Op::tf_rgb, Op::premul, Op::store_hhhh),
+};
+
+#undef KERNEL
+
+// NOLINTNEXTLINE(misc-definitions-in-headers)
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize) {
+    for (const Kernel& kernel : kKernels) {
+        if (kernel.count == programSize
+                && 0 == memcmp(kernel.program, program, (size_t)programSize * sizeof(Op))) {
+            return kernel.run;
+        }
+    }
+    return nullptr;
+}
+
+// ~~~~ byte LUTs ~~~~ //
+
+#if defined(USING_AVX2) || defined(USING_AVX512F)
+    // Look up N 8888 pixels' channels in luts, a whole vector of each channel at a time.  As in
+    // the 8888 stages, this assumes little-endian.
+    SI void exec_byte_luts_8888(const ByteLUTs& luts, const char* src, char* dst, int i) {
+        U32 px = load<U32>(src + 4*i);
+        auto lookup = [&](int c) {
+            I32 ix = cast<I32>((px >> (8*luts.src_channel[c])) & 0xff);
+            return gather_32((const uint8_t*)luts.table[c], ix);
+        };
+        store(dst + 4*i, lookup(0) | lookup(1) | lookup(2) | lookup(3));
+    }
+#endif
+
+// Without gather instructions, and for 3-byte pixels, whose channels cost more to gather into
+// vectors than the lookups save, we look up one pixel at a time.
+template <int kSrcBpp, int kDstBpp>
+static void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n) {
+    const int sr = luts.src_channel[0],
+              sg = luts.src_channel[1],
+              sb = luts.src_channel[2],
+              sa = luts.src_channel[3];
+
+    if (kSrcBpp == 4 && kDstBpp == 4) {
+        int i = 0;
+    #if defined(USING_AVX2) || defined(USING_AVX512F)
+        for (; i + N <= n; i += N) {
+            exec_byte_luts_8888(luts, src, dst, i);
+        }
+    #endif
+        const uint32_t *r = luts.table[0],
+                       *g = luts.table[1],
+                       *b = luts.table[2],
+                       *a = luts.table[3];
+        for (; i < n; i++) {
+            uint32_t px;
+            memcpy(&px, src + 4*i, 4);
+            px = r[(px >> 8*sr) & 0xff]
+               | g[(px >> 8*sg) & 0xff]
+               | b[(px >> 8*sb) & 0xff]
+               | a[(px >> 8*sa) & 0xff];
+            memcpy(dst + 4*i, &px, 4);
+        }
+        return;
+    }
+
+    const uint8_t *r = luts.bytes[0],
+                  *g = luts.bytes[1],
+                  *b = luts.bytes[2],
+                  *a = luts.bytes[3];
+    const uint8_t* s = (const uint8_t*)src;
+    uint8_t*       d = (uint8_t*)dst;
+    for (int i = 0; i < n; i++, s += kSrcBpp, d += kDstBpp) {
+        // Look up every channel before storing any, in case dst == src.
+        const uint8_t R = r[s[sr]],
+                      G = g[s[sg]],
+                      B = b[s[sb]],
+                      A = a[s[sa]];
+        d[0] = R;
+        d[1] = G;
+        d[2] = B;
+        if (kDstBpp == 4) {
+            d[3] = A;
+        }
+    }
+}
+
+// NOLINTNEXTLINE(misc-definitions-in-headers)
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp) {
+    switch (src_bpp * 8 + dst_bpp) {
+        case 3*8 + 3: run_byte_luts<3,3>(luts, src, dst, n); break;
+        case 3*8 + 4: run_byte_luts<3,4>(luts, src, dst, n); break;
+        case 4*8 + 3: run_byte_luts<4,3>(luts, src, dst, n); break;
+        case 4*8 + 4: run_byte_luts<4,4>(luts, src, dst, n); break;
+        default: assert(false);
+    }
+}
+
+// ~~~~ lowp ~~~~ //
+
+// With AVX-512, 16 float lanes already keep up with lowp, so skcms.cc never uses it there.
+#if !defined(USING_AVX512F)
+
+// The lowp pipeline runs twice as many pixels at a time as the float pipeline above, with each
+// channel in the 16-bit lanes of a Q: Q15 fixed point, always kept within [0,0x7fff].
+// Intermediate math widens to 32-bit Q32 lanes, or QF floats when we need to divide.
+
+#if N == 1
+    #define NL 1
+    template <typename T> using VL = T;
+#else
+    #define NL (2*N)
+    template <typename T> using VL = skcms_private::Vec<NL,T>;
+#endif
+
+using Q    = VL<int16_t>;
+using Q32  = VL<int32_t>;
+using QU32 = VL<uint32_t>;
+using QF   = VL<float>;
+
+#if defined(__GNUC__) && !defined(__clang__)
+    static constexpr Q32 Q32_0   = Q32() + 0,
+                         Q32_One = Q32() + 0x7fff;
+    static constexpr QF  QF_One  = QF() + 32767.0f;
+#else
+    static constexpr Q32 Q32_0   = 0,
+                         Q32_One = 0x7fff;
+    static constexpr QF  QF_One  = 32767.0f;
+#endif
+
+// Bytes map to Q15 as v*0x7fff/255, near enough v*128.5, and back with rounding.
+SI Q Q15_from_U8(const Q32& v) {
+    return cast<Q>((v << 7) | (v >> 1));
+}
+SI Q32 U8_from_Q15(const Q& v) {
+    return (cast<Q32>(v) * 255 + (1<<14)) >> 15;
+}
+
+// Q32 and QF span two native vectors, and while GCC splits most math on them into native halves,
+// it scalarizes comparisons.  So lowp clamps with shifts instead of min and max.
+SI Q clamp_Q15(const Q32& v) {
+    Q32 pos  = v & ~(v >> 31),
+        over = pos - 0x7fff;
+    return cast<Q>(pos - (over & ~(over >> 31)));
+}
+
+// c/a in Q15, where scale is 0x7fff/a and nz is 1 when a > 0, or both are 0 when a == 0,
+// matching the float unpremul stage.
+SI Q unpremul_Q15(const Q& c, const QF& scale, const Q32& nz) {
+    Q32 v = cast<Q32>(cast<QF>(cast<Q32>(c)) * scale + 0.5f);
+    return clamp_Q15(v & -nz);
+}
+
+// One row of a LowpMatrix applied to r,g,b.
+SI Q dot_Q12(const int32_t row[3], const Q32& r, const Q32& g, const Q32& b) {
+    return clamp_Q15((row[0]*r + row[1]*g + row[2]*b + (1<<11)) >> 12);
+}
+
+// Each curve table entry packs its Q15 value in the low 16 bits and the signed step to the next
+// entry in the high 16, so one 32-bit gather per lane is enough to interpolate.
+SI Q lookup_Q15(const int32_t* table, const Q& v) {
+    Q32 x  = cast<Q32>(v),
+        ix = x >> 3,
+        e;
+#if N == 1
+    e = table[ix];
+#else
+    // Gather each half with the float pipeline's N-wide gather_32().
+    I32 lo, hi;
+    memcpy(&lo, &ix, sizeof(lo));
+    memcpy(&hi, (const char*)&ix + sizeof(lo), sizeof(hi));
+    U32 elo = gather_32((const uint8_t*)table, lo),
+        ehi = gather_32((const uint8_t*)table, hi);
+    memcpy(&e, &elo, sizeof(elo));
+    memcpy((char*)&e + sizeof(elo), &ehi, sizeof(ehi));
+#endif
+    return cast<Q>((e & 0xffff) + (((e >> 16) * (x & 7) + 4) >> 3));
+}
+
+// Lowp stages mirror the float STAGE()s above, on Q15 r,g,b,a in NL lanes.
+#define LOWP_PARAMS(MAYBE_REF) SKCMS_MAYBE_UNUSED const char* src, \
+                               SKCMS_MAYBE_UNUSED char* dst,       \
+                               SKCMS_MAYBE_UNUSED Q MAYBE_REF r,   \
+                               SKCMS_MAYBE_UNUSED Q MAYBE_REF g,   \
+                               SKCMS_MAYBE_UNUSED Q MAYBE_REF b,   \
+                               SKCMS_MAYBE_UNUSED Q MAYBE_REF a,   \
+                               SKCMS_MAYBE_UNUSED int i
+
+#if SKCMS_HAS_MUSTTAIL
+
+    struct LowpStageList;
+    using LowpStageFn = void (*)(LowpStageList stages, const void** ctx, LOWP_PARAMS());
+    struct LowpStageList {
+        const LowpStageFn* fn;
+    };
+
+    #define DECLARE_LOWP_STAGE(name, arg, CALL_NEXT)                                \
+        SI void Lowp_##name##_k(arg, LOWP_PARAMS(&));                               \
+                                                                                    \
+        SI void Lowp_##name(LowpStageList list, const void** ctx, LOWP_PARAMS()) {  \
+            Lowp_##name##_k(Ctx{*ctx}, src, dst, r, g, b, a, i);                    \
+            ++list.fn; ++ctx;                                                       \
+            CALL_NEXT;                                                              \
+        }                                                                           \
+                                                                                    \
+        SI void Lowp_##name##_k(arg, LOWP_PARAMS(&))
+
+    #define LOWP_STAGE(name, arg)                                                              \
+        DECLARE_LOWP_STAGE(name, arg, [[clang::musttail]] return (*list.fn)(list, ctx, src,    \
+                                                                            dst, r, g, b, a, i))
+
+    #define FINAL_LOWP_STAGE(name, arg) \
+        DECLARE_LOWP_STAGE(name, arg, /* Stop executing stages and return to the caller. */)
+
+#else
+
+    #define DECLARE_LOWP_STAGE(name, arg)                       \
+        SI void Lowp_##name##_k(arg, LOWP_PARAMS(&));           \
+                                                                \
+        SI void Lowp_##name(const void* ctx, LOWP_PARAMS(&)) {  \
+            Lowp_##name##_k(Ctx{ctx}, src, dst, r, g, b, a, i); \
+        }                                                       \
+                                                                \
+        SI void Lowp_##name##_k(arg, LOWP_PARAMS(&))
+
+    #define LOWP_STAGE(name, arg)       DECLARE_LOWP_STAGE(name, arg)
+    #define FINAL_LOWP_STAGE(name, arg) DECLARE_LOWP_STAGE(name, arg)
+
+#endif
+
+LOWP_STAGE(load_888, NoCtx) {
+    const uint8_t* rgb = (const uint8_t*)(src + 3*i);
+    int32_t R[NL], G[NL], B[NL];
+    for (int k = 0; k < NL; k++) {
+        R[k] = rgb[3*k+0];
+        G[k] = rgb[3*k+1];
+        B[k] = rgb[3*k+2];
     }
+    r = Q15_from_U8(load<Q32>(R));
+    g = Q15_from_U8(load<Q32>(G));
+    b = Q15_from_U8(load<Q32>(B));
+    a = cast<Q>(Q32_One);
 }
+
+LOWP_STAGE(load_8888, NoCtx) {
+    QU32 rgba = load<QU32>(src + 4*i);
+    r = Q15_from_U8(cast<Q32>((rgba >>  0) & 0xff));
+    g = Q15_from_U8(cast<Q32>((rgba >>  8) & 0xff));
+    b = Q15_from_U8(cast<Q32>((rgba >> 16) & 0xff));
+    a = Q15_from_U8(cast<Q32>((rgba >> 24) & 0xff));
+}
+
+LOWP_STAGE(swap_rb, NoCtx) {
+    Q t = r;
+    r = b;
+    b = t;
+}
+
+LOWP_STAGE(force_opaque, NoCtx) {
+    a = cast<Q>(Q32_One);
+}
+
+LOWP_STAGE(premul, NoCtx) {
+    Q32 A = cast<Q32>(a);
+    r = cast<Q>((cast<Q32>(r) * A + (1<<14)) >> 15);
+    g = cast<Q>((cast<Q32>(g) * A + (1<<14)) >> 15);
+    b = cast<Q>((cast<Q32>(b) * A + (1<<14)) >> 15);
+}
+
+LOWP_STAGE(unpremul, NoCtx) {
+    // a is never negative, so a-1 is negative only when a == 0.
+    Q32 A  = cast<Q32>(a),
+        nz = 1 + ((A - 1) >> 31);
+    QF scale = QF_One / cast<QF>(A + 1 - nz);
+    r = unpremul_Q15(r, scale, nz);
+    g = unpremul_Q15(g, scale, nz);
+    b = unpremul_Q15(b, scale, nz);
+}
+
+LOWP_STAGE(matrix_3x3, const LowpMatrix* m) {
+    Q32 R = cast<Q32>(r),
+        G = cast<Q32>(g),
+        B = cast<Q32>(b);
+    r = dot_Q12(m->vals[0], R, G, B);
+    g = dot_Q12(m->vals[1], R, G, B);
+    b = dot_Q12(m->vals[2], R, G, B);
+}
+
+LOWP_STAGE(curves, const LowpCurves* curves) {
+    if (curves->table[0]) { r = lookup_Q15(curves->table[0], r); }
+    if (curves->table[1]) { g = lookup_Q15(curves->table[1], g); }
+    if (curves->table[2]) { b = lookup_Q15(curves->table[2], b); }
+}
+
+FINAL_LOWP_STAGE(store_888, NoCtx) {
+    uint8_t* rgb = (uint8_t*)(dst + 3*i);
+    int32_t R[NL], G[NL], B[NL];
+    store(R, U8_from_Q15(r));
+    store(G, U8_from_Q15(g));
+    store(B, U8_from_Q15(b));
+    for (int k = 0; k < NL; k++) {
+        rgb[3*k+0] = (uint8_t)R[k];
+        rgb[3*k+1] = (uint8_t)G[k];
+        rgb[3*k+2] = (uint8_t)B[k];
+    }
+}
+
+FINAL_LOWP_STAGE(store_8888, NoCtx) {
+    store(dst + 4*i, cast<QU32>(U8_from_Q15(r)) <<  0
+                   | cast<QU32>(U8_from_Q15(g)) <<  8
+                   | cast<QU32>(U8_from_Q15(b)) << 16
+                   | cast<QU32>(U8_from_Q15(a)) << 24);
+}
+
+#if SKCMS_HAS_MUSTTAIL
+
+    SI void exec_lowp(LowpStageFn* stages, const void** contexts,
+                      const char* src, char* dst, int i) {
+        Q zero = cast<Q>(Q32_0);
+        (*stages)({stages}, contexts, src, dst, zero, zero, zero, zero, i);
+    }
+
+#else
+
+    static void exec_lowp(const LowpOp* ops, const void** contexts,
+                          const char* src, char* dst, int i) {
+        Q r = cast<Q>(Q32_0), g = r, b = r, a = r;
+        while (true) {
+            switch (*ops++) {
+#define M(name) case LowpOp::name: Lowp_##name(*contexts++, src, dst, r, g, b, a, i); break;
+                SKCMS_LOWP_WORK_OPS(M)
+#undef M
+#define M(name) case LowpOp::name: Lowp_##name(*contexts++, src, dst, r, g, b, a, i); return;
+                SKCMS_LOWP_STORE_OPS(M)
+#undef M
+            }
+        }
+    }
+
+#endif
+
+// NOLINTNEXTLINE(misc-definitions-in-headers)
+void run_program_lowp(const LowpOp* program, const void** contexts,
+                      SKCMS_MAYBE_UNUSED ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp) {
+#if SKCMS_HAS_MUSTTAIL
+    // Convert the program into an array of tailcall stages.
+    LowpStageFn stages[32];
+    assert(programSize <= ARRAY_COUNT(stages));
+
+    static constexpr LowpStageFn kStageFns[] = {
+#define M(name) &Lowp_##name,
+        SKCMS_LOWP_WORK_OPS(M)
+        SKCMS_LOWP_STORE_OPS(M)
+#undef M
+    };
+
+    for (ptrdiff_t index = 0; index < programSize; ++index) {
+        stages[index] = kStageFns[(int)program[index]];
+    }
+#else
+    // Use the op array as-is.
+    const LowpOp* stages = program;
+#endif
+
+    int i = 0;
+    while (n >= NL) {
+        exec_lowp(stages, contexts, src, dst, i);
+        i += NL;
+        n -= NL;
+    }
+    if (n > 0) {
+        char tmp[4*NL] = {0};
+        memcpy(tmp, src + (size_t)i*src_bpp, (size_t)n*src_bpp);
+        exec_lowp(stages, contexts, tmp, tmp, 0);
+        memcpy(dst + (size_t)i*dst_bpp, tmp, (size_t)n*dst_bpp);
+    }
+}
+
+#undef NL
+
+#endif  // !defined(USING_AVX512F)
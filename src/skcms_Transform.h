@@ -17,103 +17,287 @@ namespace skcms_private {
 
 /** All transform ops */
 
-#define SKCMS_WORK_OPS(M) \
-    M(load_a8)            \
-    M(load_g8)            \
-    M(load_ga88)          \
-    M(load_4444)          \
-    M(load_565)           \
-    M(load_888)           \
-    M(load_8888)          \
-    M(load_1010102)       \
-    M(load_101010x_XR)    \
-    M(load_10101010_XR)   \
-    M(load_161616LE)      \
-    M(load_16161616LE)    \
-    M(load_161616BE)      \
-    M(load_16161616BE)    \
-    M(load_hhh)           \
-    M(load_hhhh)          \
-    M(load_fff)           \
-    M(load_ffff)          \
-                          \
-    M(swap_rb)            \
-    M(clamp)              \
-    M(invert)             \
-    M(force_opaque)       \
-    M(premul)             \
-    M(unpremul)           \
-    M(matrix_3x3)         \
-    M(matrix_3x4)         \
-                          \
-    M(lab_to_xyz)         \
-    M(xyz_to_lab)         \
-                          \
-    M(gamma_r)            \
-    M(gamma_g)            \
-    M(gamma_b)            \
-    M(gamma_a)            \
-    M(gamma_rgb)          \
-                          \
-    M(tf_r)               \
-    M(tf_g)               \
-    M(tf_b)               \
-    M(tf_a)               \
-    M(tf_rgb)             \
-                          \
-    M(pq_r)               \
-    M(pq_g)               \
-    M(pq_b)               \
-    M(pq_a)               \
-    M(pq_rgb)             \
-                          \
-    M(hlg_r)              \
-    M(hlg_g)              \
-    M(hlg_b)              \
-    M(hlg_a)              \
-    M(hlg_rgb)            \
-    M(hlg_ootf_scale)     \
-                          \
-    M(hlginv_r)           \
-    M(hlginv_g)           \
-    M(hlginv_b)           \
-    M(hlginv_a)           \
-    M(hlginv_rgb)         \
-    M(hlginv_ootf_scale)  \
-                          \
-    M(table_r)            \
-    M(table_g)            \
-    M(table_b)            \
-    M(table_a)            \
-                          \
-    M(clut_A2B)           \
-    M(clut_B2A)
-
-#define SKCMS_STORE_OPS(M) \
-    M(store_a8)            \
-    M(store_g8)            \
-    M(store_ga88)          \
-    M(store_4444)          \
-    M(store_565)           \
-    M(store_888)           \
-    M(store_8888)          \
-    M(store_1010102)       \
-    M(store_161616LE)      \
-    M(store_16161616LE)    \
-    M(store_161616BE)      \
-    M(store_16161616BE)    \
-    M(store_101010x_XR)    \
-    M(store_10101010_XR)   \
-    M(store_hhh)           \
-    M(store_hhhh)          \
-    M(store_fff)           \
-    M(store_ffff)
+#define SKCMS_WORK_OPS(M)    \
+    M(load_a8)               \
+    M(load_g8)               \
+    M(load_ga88)             \
+    M(load_4444)             \
+    M(load_565)              \
+    M(load_888)              \
+    M(load_8888)             \
+    M(load_1010102)          \
+    M(load_101010x_XR)       \
+    M(load_10101010_XR)      \
+    M(load_161616LE)         \
+    M(load_16161616LE)       \
+    M(load_161616BE)         \
+    M(load_16161616BE)       \
+    M(load_hhh)              \
+    M(load_hhhh)             \
+    M(load_fff)              \
+    M(load_ffff)             \
+                             \
+    M(load_planar_888)       \
+    M(load_planar_8888)      \
+    M(load_planar_161616)    \
+    M(load_planar_16161616)  \
+    M(load_planar_hhh)       \
+    M(load_planar_hhhh)      \
+    M(load_planar_fff)       \
+    M(load_planar_ffff)      \
+                             \
+    M(load_ycbcr_h2_888)     \
+    M(load_ycbcr_h2_semi_8)  \
+    M(load_ycbcr_h2_semi_16) \
+                             \
+    M(swap_rb)               \
+    M(clamp)                 \
+    M(invert)                \
+    M(force_opaque)          \
+    M(premul)                \
+    M(unpremul)              \
+    M(matrix_3x3)            \
+    M(matrix_3x4)            \
+                             \
+    M(lab_to_xyz)            \
+    M(xyz_to_lab)            \
+                             \
+    M(gamma_r)               \
+    M(gamma_g)               \
+    M(gamma_b)               \
+    M(gamma_a)               \
+    M(gamma_rgb)             \
+                             \
+    M(tf_r)                  \
+    M(tf_g)                  \
+    M(tf_b)                  \
+    M(tf_a)                  \
+    M(tf_rgb)                \
+                             \
+    M(pq_r)                  \
+    M(pq_g)                  \
+    M(pq_b)                  \
+    M(pq_a)                  \
+    M(pq_rgb)                \
+                             \
+    M(hlg_r)                 \
+    M(hlg_g)                 \
+    M(hlg_b)                 \
+    M(hlg_a)                 \
+    M(hlg_rgb)               \
+    M(hlg_ootf_scale)        \
+                             \
+    M(hlginv_r)              \
+    M(hlginv_g)              \
+    M(hlginv_b)              \
+    M(hlginv_a)              \
+    M(hlginv_rgb)            \
+    M(hlginv_ootf_scale)     \
+                             \
+    M(table_r)               \
+    M(table_g)               \
+    M(table_b)               \
+    M(table_a)               \
+                             \
+    M(table_small_r)         \
+    M(table_small_g)         \
+    M(table_small_b)         \
+    M(table_small_a)         \
+                             \
+    M(clut_A2B)              \
+    M(clut_B2A)              \
+    M(clut_A2B_simplex)      \
+    M(clut_B2A_simplex)      \
+                             \
+    M(baked_lut)
+
+#define SKCMS_STORE_OPS(M)   \
+    M(store_a8)              \
+    M(store_g8)              \
+    M(store_ga88)            \
+    M(store_4444)            \
+    M(store_565)             \
+    M(store_888)             \
+    M(store_8888)            \
+    M(store_1010102)         \
+    M(store_161616LE)        \
+    M(store_16161616LE)      \
+    M(store_161616BE)        \
+    M(store_16161616BE)      \
+    M(store_101010x_XR)      \
+    M(store_10101010_XR)     \
+    M(store_hhh)             \
+    M(store_hhhh)            \
+    M(store_fff)             \
+    M(store_ffff)            \
+                             \
+    M(store_planar_888)      \
+    M(store_planar_8888)     \
+    M(store_planar_161616)   \
+    M(store_planar_16161616) \
+    M(store_planar_hhh)      \
+    M(store_planar_hhhh)     \
+    M(store_planar_fff)      \
+    M(store_planar_ffff)
+
+// Fused ops each run a common sequence of the ops above as one stage, named for the ops they
+// replace and reading those ops' contexts in order: M(name, number of ops fused).
+#define SKCMS_FUSED_WORK_OPS(M)      \
+    M(load_8888_tf_rgb,        2)    \
+    M(matrix_3x3_tf_rgb,       2)
+
+#define SKCMS_FUSED_STORE_OPS(M)     \
+    M(tf_rgb_clamp_store_8888, 3)    \
+    M(premul_store_8888,       2)
 
 enum class Op : int {
 #define M(op) op,
     SKCMS_WORK_OPS(M)
     SKCMS_STORE_OPS(M)
 #undef M
+#define M(op, n) op,
+    SKCMS_FUSED_WORK_OPS(M)
+    SKCMS_FUSED_STORE_OPS(M)
+#undef M
+};
+
+#define M(op) + 1
+#define M2(op, n) + 1
+static constexpr int kOpCount = 0 SKCMS_WORK_OPS(M)       SKCMS_STORE_OPS(M)
+                                  SKCMS_FUSED_WORK_OPS(M2) SKCMS_FUSED_STORE_OPS(M2);
+#undef M
+#undef M2
+
+// Planar loads and stores use src or dst as a skcms_PlanarBuffer, with one channel per plane,
+// or for semi-planar YCbCr, chroma pairs interleaved in a second plane.
+struct PlanarLayout {
+    int    planes;    // 0 for ops that don't load or store planar pixels.
+    size_t bytes[4];  // Bytes per sample (or chroma pair) in each plane...
+    int    shift[4];  // ...and log2 of each plane's horizontal subsampling.
+};
+
+inline PlanarLayout planar_layout(Op op) {
+    PlanarLayout layout = { 0, {0,0,0,0}, {0,0,0,0} };
+
+    // The plain planar ops are declared in the same order for loads and stores, alternating 3
+    // and 4 planes of 8-bit, 16-bit, half, and float samples.
+    int index = (int)op - (int)Op::load_planar_888;
+    if (index < 0 || index >= 8) {
+        index = (int)op - (int)Op::store_planar_888;
+    }
+    if (0 <= index && index < 8) {
+        static constexpr size_t kBytes[] = { 1, 2, 2, 4 };
+        layout.planes = 3 + (index & 1);
+        for (int p = 0; p < layout.planes; p++) {
+            layout.bytes[p] = kBytes[index >> 1];
+        }
+    }
+
+    // YCbCr with chroma at half horizontal resolution, in two chroma planes or one of pairs.
+    if (op == Op::load_ycbcr_h2_888) {
+        layout = { 3, {1,1,1,0}, {0,1,1,0} };
+    }
+    if (op == Op::load_ycbcr_h2_semi_8) {
+        layout = { 2, {1,2,0,0}, {0,1,0,0} };
+    }
+    if (op == Op::load_ycbcr_h2_semi_16) {
+        layout = { 2, {2,4,0,0}, {0,1,0,0} };
+    }
+    return layout;
+}
+
+/** Lowp ops */
+
+// A second flavor of program for transforms between 8-bit formats, working in 16-bit Q15 fixed
+// point (0x7fff is 1.0) to fit twice as many pixels in each register as float.  Curves become
+// lookup tables sampled from the float ops they replace; anything else keeps the float program.
+#define SKCMS_LOWP_WORK_OPS(M) \
+    M(load_888)                \
+    M(load_8888)               \
+    M(swap_rb)                 \
+    M(force_opaque)            \
+    M(premul)                  \
+    M(unpremul)                \
+    M(matrix_3x3)              \
+    M(curves)
+
+#define SKCMS_LOWP_STORE_OPS(M) \
+    M(store_888)                \
+    M(store_8888)
+
+enum class LowpOp : int {
+#define M(op) op,
+    SKCMS_LOWP_WORK_OPS(M)
+    SKCMS_LOWP_STORE_OPS(M)
+#undef M
+};
+
+// matrix_3x3 coefficients in Q12.  Each row's absolute values must sum to less than 16, so that
+// its dot product with Q15 r,g,b can't overflow 32 bits.
+struct LowpMatrix {
+    int32_t vals[3][3];
+};
+
+// A curve for each of r,g,b, or null to leave that channel alone.  Each table holds 4096 entries
+// of the curve at x = 8k/0x7fff, for lookups by the top 12 bits of a Q15 input, lerping by the
+// other 3.  Entries pack the Q15 value at k in their low 16 bits, and the signed difference from
+// it to the value at k+1 in their high 16 bits.
+static constexpr int kLowpCurveEntries = 4096;
+struct LowpCurves {
+    const int32_t* table[3];
+};
+
+// A whole transform's color conversion sampled on a grid_points^3 lattice spanning [0,1]^3 of
+// source r,g,b, for baked_lut to interpolate.  Each entry holds the destination r,g,b as floats,
+// with b varying fastest, then g, then r.
+struct BakedLUT {
+    int          grid_points;
+    const float* table;
+};
+
+// The context for table_*: a curve table, and when pairs is not null, the same table decoded to
+// floats as (entry k, entry k+1 - entry k) pairs, so one 64-bit gather finds both ends of a lerp.
+struct TableLUT {
+    const skcms_Curve* curve;
+    const float*       pairs;
+};
+
+// The context for clut_*: an A2B or B2A CLUT, and when packed is not null, its grid repacked by
+// pack_cluts() into native-endian entries of exactly 4 channels, 4 bytes each for 8-bit grids or
+// 8 bytes for 16-bit ones.  Channels past output_channels are 0.
+//
+// If blocked is also set, the packed grid is tiled into blocks of 2^(kCLUTBlockBits*dim) entries,
+// kCLUTBlockBits bits of each coordinate, stored in Z-order within each block.  block_strides[i]
+// is the distance in entries between neighboring blocks along dimension i; see clut_offset().
+static constexpr int kCLUTBlockBits = 1;
+
+struct CLUT {
+    uint32_t       input_channels,
+                   output_channels;
+    const uint8_t* grid_points;
+    const uint8_t* grid_8;
+    const uint8_t* grid_16;
+    const uint8_t* packed;
+    bool           blocked;
+    int            block_strides[4];
+};
+
+// A curve table of up to 32 entries decoded to floats, small enough for table_small_* to hold in
+// registers and look up with permutes rather than gathers.  Past the last entry, vals repeat it.
+static constexpr int kMaxSmallTableEntries = 32;
+struct SmallTable {
+    float scale;  // table_entries - 1
+    float vals[kMaxSmallTableEntries];
+};
+
+// A transform between 8-bit formats whose ops never mix channels, e.g. retagging between profiles
+// that share a gamut, is just one 256-entry lookup per channel.  For 8888 pixels, each entry
+// holds its byte already shifted into place, so looking up all four channels of a pixel and ORing
+// them together makes the destination pixel.  3-byte pixels look up plain bytes.
+struct ByteLUTs {
+    uint32_t table[4][256];   // Indexed by destination channel, then source byte.
+    uint8_t  bytes[4][256];   // The same, unshifted.
+    int      src_channel[4];  // Which source byte each destination channel looks up.
 };
 
 /** Constants */
@@ -143,11 +327,44 @@ enum class Op : int {
 
 /** Interface */
 
+using RunProgramFn = void (*)(const Op* program, const void** contexts, ptrdiff_t programSize,
+                              const char* src, char* dst, int n,
+                              size_t src_bpp, size_t dst_bpp);
+
+#if defined(SKCMS_PROFILE)
+    // Profiling builds' run_program() times each op it runs with profile_ticks(), and adds it up
+    // with record_stage().  See skcms_GetStageProfile().
+    uint64_t profile_ticks();
+    void record_stage(Op op, uint64_t ticks);
+#endif
+
+// Each backend's run_program() runs any program.  find_kernel() returns a faster one specialized
+// for exactly this program when there is one, or nullptr.  run_byte_luts() runs ByteLUTs.
+
 namespace baseline {
 
 void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
                  const char* src, char* dst, int n,
                 size_t src_bpp, size_t dst_bpp);
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize);
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp);
+void run_program_lowp(const LowpOp* program, const void** contexts, ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp);
+
+}
+namespace sse41 {
+
+void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
+                 const char* src, char* dst, int n,
+                size_t src_bpp, size_t dst_bpp);
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize);
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp);
+void run_program_lowp(const LowpOp* program, const void** contexts, ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp);
 
 }
 namespace hsw {
@@ -155,6 +372,12 @@ namespace hsw {
 void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
                  const char* src, char* dst, int n,
                 size_t src_bpp, size_t dst_bpp);
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize);
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp);
+void run_program_lowp(const LowpOp* program, const void** contexts, ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp);
 
 }
 namespace skx {
@@ -162,6 +385,26 @@ namespace skx {
 void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
                  const char* src, char* dst, int n,
                 size_t src_bpp, size_t dst_bpp);
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize);
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp);
+
+}
+namespace jit {
+
+// A program compiled by jit::compile() to x86-64 AVX2 machine code, with its matrix and transfer
+// function parameters baked into the code.  code is null when there is none.
+struct Program {
+    void*  code;
+    size_t size;
+};
+
+// Only some ops can be compiled, and only on x86-64 outside Windows.  compile() returns false for
+// programs it can't compile, leaving *out untouched.  The caller checks the CPU supports AVX2.
+bool compile(const Op* program, const void** contexts, ptrdiff_t programSize, Program* out);
+void run(const Program&, const char* src, char* dst, size_t n,
+         size_t src_bpp, size_t dst_bpp);
+void release(Program*);
 
 }
 }  // namespace skcms_private
@@ -45,6 +45,22 @@ void run_program(const Op* program, const void** contexts, ptrdiff_t programSize
                                          src, dst, n, src_bpp, dst_bpp);
 }
 
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize) {
+    return skcms_private::baseline::find_kernel(program, programSize);
+}
+
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp) {
+    skcms_private::baseline::run_byte_luts(luts, src, dst, n, src_bpp, dst_bpp);
+}
+
+void run_program_lowp(const LowpOp* program, const void** contexts, ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp) {
+    skcms_private::baseline::run_program_lowp(program, contexts, programSize,
+                                              src, dst, n, src_bpp, dst_bpp);
+}
+
 #else
 
 #define USING_AVX
@@ -0,0 +1,548 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "skcms_public.h"     // NO_G3_REWRITE
+#include "skcms_internals.h"  // NO_G3_REWRITE
+#include "skcms_Transform.h"  // NO_G3_REWRITE
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MemorySanitizer can't see the stores our generated code makes.
+#if defined(__has_feature)
+    #if __has_feature(memory_sanitizer) && !defined(SKCMS_DISABLE_JIT)
+        #define SKCMS_DISABLE_JIT 1
+    #endif
+#endif
+
+// We emit AVX2 code, so there's no JIT where we wouldn't build the HSW backend.  Windows would
+// need its own calling convention and VirtualAlloc(), which we haven't written.
+#if !defined(SKCMS_DISABLE_JIT) && (defined(SKCMS_DISABLE_HSW) || defined(_WIN32))
+    #define SKCMS_DISABLE_JIT 1
+#endif
+
+#if !defined(SKCMS_DISABLE_JIT)
+    #include <sys/mman.h>
+#endif
+
+namespace skcms_private {
+namespace jit {
+
+#if defined(SKCMS_DISABLE_JIT)
+
+bool compile(const Op*, const void**, ptrdiff_t, Program*) { return false; }
+void run(const Program&, const char*, char*, size_t, size_t, size_t) {}
+void release(Program*) {}
+
+#else
+
+// Generated code runs 8 pixels at a time, and has the System V signature
+//    void fn(const char* src, char* dst, size_t n)
+// for n groups of 8 pixels, n > 0.  ymm0-3 hold r,g,b,a, ymm4-15 are scratch.
+//
+// Each op computes exactly the same float operations in the same order as its stage in
+// Transform_inl.h, so results match hsw::run_program() bit for bit.  AVX2 has no float
+// immediates, so constants live in a pool after the code, each broadcast to a full register.
+static constexpr size_t kStride = 8;
+
+using JitFn = void(const char* src, char* dst, size_t n);
+
+enum { RDX = 2, RSI = 6, RDI = 7 };
+
+// An instruction's r/m operand: a ymm register, memory at a general register plus offset, or
+// a constant from the pool.
+struct Operand {
+    enum { Reg, Mem, Const } kind;
+    int      reg;   // ymm register for Reg, general register for Mem.
+    int      disp;
+    uint32_t bits;
+};
+
+static Operand Y(int reg)               { return { Operand::Reg,   reg, 0,    0 }; }
+static Operand M(int reg, int disp)     { return { Operand::Mem,   reg, disp, 0 }; }
+static Operand K(uint32_t bits)         { return { Operand::Const, 0,   0,    bits }; }
+static Operand K(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return K(bits);
+}
+
+// VEX prefix fields.
+enum { PP_NONE = 0, PP_66 = 1, PP_F3 = 2 };
+enum { MAP_0F = 1, MAP_0F3A = 3 };
+enum { CMP_EQ_OQ = 0, CMP_LT_OS = 1 };
+
+struct Assembler {
+    uint8_t  code[65536];
+    size_t   len;
+    bool     ok;
+
+    uint32_t consts[256];
+    int      nconsts;
+
+    // Each constant reference's rel32 is patched once we know where the pool lands.
+    struct Fixup { size_t at, end; int index; };
+    Fixup    fixups[4096];
+    int      nfixups;
+
+    void byte(int b) {
+        if (len < sizeof(code)) {
+            code[len++] = (uint8_t)b;
+        } else {
+            ok = false;
+        }
+    }
+    void dword(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            byte((int)(v >> (8*i)) & 0xff);
+        }
+    }
+
+    int constant(uint32_t bits) {
+        for (int i = 0; i < nconsts; i++) {
+            if (consts[i] == bits) {
+                return i;
+            }
+        }
+        if (nconsts == ARRAY_COUNT(consts)) {
+            ok = false;
+            return 0;
+        }
+        consts[nconsts] = bits;
+        return nconsts++;
+    }
+
+    // A 256-bit VEX instruction: reg is ModRM.reg (a register or opcode extension), vvvv the
+    // extra source register, and imm an immediate byte if >= 0.
+    void vex(int pp, int map, int opcode, int reg, int vvvv, Operand rm, int imm = -1) {
+        const int base = rm.kind == Operand::Const ? 0 : rm.reg;
+        byte(0xc4);
+        byte((~reg & 8) << 4 | 0x40 | (~base & 8) << 2 | map);
+        byte((~vvvv & 15) << 3 | 0x04 | pp);
+        byte(opcode);
+
+        size_t fixup = 0;
+        switch (rm.kind) {
+            case Operand::Reg:
+                byte(0xc0 | (reg & 7) << 3 | (rm.reg & 7));
+                break;
+            case Operand::Mem:
+                // We only address through rdi and rsi, so never need a SIB byte.
+                if (-128 <= rm.disp && rm.disp < 128) {
+                    byte(0x40 | (reg & 7) << 3 | (rm.reg & 7));
+                    byte(rm.disp & 0xff);
+                } else {
+                    byte(0x80 | (reg & 7) << 3 | (rm.reg & 7));
+                    dword((uint32_t)rm.disp);
+                }
+                break;
+            case Operand::Const:
+                byte(0x05 | (reg & 7) << 3);  // [rip + rel32]
+                fixup = len;
+                dword(0);
+                break;
+        }
+        if (imm >= 0) {
+            byte(imm);
+        }
+        if (rm.kind == Operand::Const) {
+            if (nfixups == ARRAY_COUNT(fixups)) {
+                ok = false;
+                return;
+            }
+            fixups[nfixups++] = { fixup, len, constant(rm.bits) };
+        }
+    }
+
+    void ps(int opcode, int dst, int src1, Operand src2) {
+        vex(PP_NONE, MAP_0F, opcode, dst, src1, src2);
+    }
+
+    void vaddps  (int d, int s, Operand o) { ps(0x58, d, s, o); }
+    void vmulps  (int d, int s, Operand o) { ps(0x59, d, s, o); }
+    void vsubps  (int d, int s, Operand o) { ps(0x5c, d, s, o); }
+    void vminps  (int d, int s, Operand o) { ps(0x5d, d, s, o); }
+    void vdivps  (int d, int s, Operand o) { ps(0x5e, d, s, o); }
+    void vmaxps  (int d, int s, Operand o) { ps(0x5f, d, s, o); }
+    void vandps  (int d, int s, Operand o) { ps(0x54, d, s, o); }
+    void vorps   (int d, int s, Operand o) { ps(0x56, d, s, o); }
+    void vxorps  (int d, int s, Operand o) { ps(0x57, d, s, o); }
+    void vunpcklps(int d, int s, Operand o) { ps(0x14, d, s, o); }
+    void vunpckhps(int d, int s, Operand o) { ps(0x15, d, s, o); }
+    void vunpcklpd(int d, int s, Operand o) { vex(PP_66, MAP_0F, 0x14, d, s, o); }
+    void vunpckhpd(int d, int s, Operand o) { vex(PP_66, MAP_0F, 0x15, d, s, o); }
+
+    void vmovups(int d, Operand o)  { vex(PP_NONE, MAP_0F, 0x10, d, 0, o); }
+    void vmovups(Operand o, int s)  { vex(PP_NONE, MAP_0F, 0x11, s, 0, o); }
+    void vcvtdq2ps (int d, int s)   { vex(PP_NONE, MAP_0F, 0x5b, d, 0, Y(s)); }
+    void vcvttps2dq(int d, int s)   { vex(PP_F3,   MAP_0F, 0x5b, d, 0, Y(s)); }
+    void vpsrld(int d, int s, int n) { vex(PP_66, MAP_0F, 0x72, 2, d, Y(s), n); }
+    void vpslld(int d, int s, int n) { vex(PP_66, MAP_0F, 0x72, 6, d, Y(s), n); }
+
+    void vcmpps(int d, int s, Operand o, int pred) { vex(PP_NONE, MAP_0F, 0xc2, d, s, o, pred); }
+    void vroundps(int d, int s, int mode)          { vex(PP_66, MAP_0F3A, 0x08, d, 0, Y(s), mode); }
+    void vperm2f128(int d, int s, int o, int sel)  { vex(PP_66, MAP_0F3A, 0x06, d, s, Y(o), sel); }
+
+    // d = mask ? t : e, with the mask in each lane's sign bit.
+    void vblendvps(int d, int e, int t, int mask) {
+        vex(PP_66, MAP_0F3A, 0x4a, d, e, Y(t), mask << 4);
+    }
+
+    void add_imm(int reg, uint32_t imm) {  // add reg, imm32
+        byte(0x48); byte(0x81); byte(0xc0 | reg); dword(imm);
+    }
+};
+
+// Which of ymm0-3 holds each of r,g,b,a.  swap_rb just renames.
+struct Channels {
+    int reg[4] = {0,1,2,3};
+};
+
+// Scratch registers used below.
+enum { T0 = 4, T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11 };
+
+// apply_gamma() and apply_tf() both end in approx_pow(); this computes it in place in x,
+// using T2-T6 as scratch.
+static void approx_pow(Assembler* a, int x, float g) {
+    const int mask = T2, e = T3, m = T4, t = T5, u = T6;
+
+    // Pass through x exactly where x == 0 or x == 1.
+    a->vcmpps(mask, x, K(0.0f), CMP_EQ_OQ);
+    a->vcmpps(t,    x, K(1.0f), CMP_EQ_OQ);
+    a->vorps (mask, mask, Y(t));
+
+    // approx_log2(x)
+    a->vcvtdq2ps(e, x);
+    a->vmulps(e, e, K(1.0f / (1<<23)));
+    a->vandps(m, x, K(0x007fffffu));
+    a->vorps (m, m, K(0x3f000000u));
+    a->vsubps(e, e, K(124.225514990f));
+    a->vmulps(t, m, K(1.498030302f));
+    a->vsubps(e, e, Y(t));
+    a->vaddps(m, m, K(0.3520887068f));
+    a->vmovups(t, K(1.725879990f));
+    a->vdivps(t, t, Y(m));
+    a->vsubps(e, e, Y(t));
+
+    a->vmulps(e, e, K(g));
+
+    // approx_exp2(e)
+    a->vroundps(t, e, 0x01/*floor*/);
+    a->vsubps(t, e, Y(t));                      // fract
+    a->vaddps(u, e, K(121.274057500f));
+    a->vmulps(m, t, K(1.490129070f));
+    a->vsubps(u, u, Y(m));
+    a->vmovups(m, K(4.84252568f));
+    a->vsubps(m, m, Y(t));
+    a->vmovups(e, K(27.728023300f));
+    a->vdivps(e, e, Y(m));
+    a->vaddps(u, u, Y(e));
+    a->vmulps(u, u, K(1.0f * (1<<23)));
+
+    // min_(max_(fbits, F0), FInfBits), keeping min_() and max_()'s handling of NaN.
+    a->vxorps(e, e, Y(e));
+    a->vmaxps(u, e, Y(u));
+    a->vmovups(e, K((float)0x7f800000));
+    a->vminps(u, e, Y(u));
+    a->vcvttps2dq(u, u);
+
+    a->vblendvps(x, u, x, mask);
+}
+
+// x = |x|, with its sign bit left in T0.
+static void strip_sign(Assembler* a, int x) {
+    a->vandps(T0, x, K(0x80000000u));
+    a->vxorps(x, x, Y(T0));
+}
+
+static void apply_gamma(Assembler* a, const skcms_TransferFunction* tf, int x) {
+    strip_sign(a, x);
+    approx_pow(a, x, tf->g);
+    a->vorps(x, x, Y(T0));
+}
+
+static void apply_tf(Assembler* a, const skcms_TransferFunction* tf, int x) {
+    strip_sign(a, x);
+
+    // Linear part in T1, exponential part in T7.
+    a->vmulps(T1, x, K(tf->c));
+    a->vaddps(T1, T1, K(tf->f));
+    a->vmulps(T7, x, K(tf->a));
+    a->vaddps(T7, T7, K(tf->b));
+    approx_pow(a, T7, tf->g);
+    a->vaddps(T7, T7, K(tf->e));
+
+    a->vcmpps(T2, x, K(tf->d), CMP_LT_OS);
+    a->vblendvps(x, T7, T1, T2);
+    a->vorps(x, x, Y(T0));
+}
+
+static void matrix(Assembler* a, Channels* ch, const float* m, int cols) {
+    const int out[3] = { T2, T3, T4 };
+    for (int row = 0; row < 3; row++) {
+        const float* v = m + row*cols;
+        a->vmulps(out[row], ch->reg[0], K(v[0]));
+        a->vmulps(T0, ch->reg[1], K(v[1]));
+        a->vaddps(out[row], out[row], Y(T0));
+        a->vmulps(T0, ch->reg[2], K(v[2]));
+        a->vaddps(out[row], out[row], Y(T0));
+        if (cols == 4) {
+            a->vaddps(out[row], out[row], K(v[3]));
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        a->vmovups(ch->reg[c], Y(out[c]));
+    }
+}
+
+// Emit one op, returning false if we can't.
+static bool emit(Assembler* a, Channels* ch, Op op, const void* ctx, size_t* src_bpp,
+                 size_t* dst_bpp) {
+    const int r = ch->reg[0],
+              g = ch->reg[1],
+              b = ch->reg[2],
+              A = ch->reg[3];
+    const skcms_TransferFunction* tf = (const skcms_TransferFunction*)ctx;
+
+    switch (op) {
+        case Op::load_8888:
+            *src_bpp = 4;
+            a->vmovups(T0, M(RDI, 0));
+            for (int c = 0; c < 4; c++) {
+                int bits = T0;
+                if (c > 0) {
+                    a->vpsrld(T1, T0, 8*c);
+                    bits = T1;
+                }
+                if (c < 3) {
+                    a->vandps(T1, bits, K(0xffu));
+                    bits = T1;
+                }
+                a->vcvtdq2ps(ch->reg[c], bits);
+                a->vmulps(ch->reg[c], ch->reg[c], K(1/255.0f));
+            }
+            return true;
+
+        case Op::load_ffff:
+            // Pixels 0-1, 2-3, 4-5, 6-7, rearranged to 0|4, 1|5, 2|6, 3|7, then transposed
+            // within each 128-bit half.
+            *src_bpp = 16;
+            for (int k = 0; k < 4; k++) {
+                a->vmovups(T0+k, M(RDI, 32*k));
+            }
+            a->vperm2f128(T4, T0, T2, 0x20);
+            a->vperm2f128(T5, T0, T2, 0x31);
+            a->vperm2f128(T6, T1, T3, 0x20);
+            a->vperm2f128(T7, T1, T3, 0x31);
+            a->vunpcklps(T0, T4, Y(T5));
+            a->vunpckhps(T1, T4, Y(T5));
+            a->vunpcklps(T2, T6, Y(T7));
+            a->vunpckhps(T3, T6, Y(T7));
+            a->vunpcklpd(r, T0, Y(T2));
+            a->vunpckhpd(g, T0, Y(T2));
+            a->vunpcklpd(b, T1, Y(T3));
+            a->vunpckhpd(A, T1, Y(T3));
+            return true;
+
+        case Op::swap_rb:
+            ch->reg[0] = b;
+            ch->reg[2] = r;
+            return true;
+
+        case Op::clamp:
+            a->vmovups(T0, K(1.0f));
+            for (int c = 0; c < 4; c++) {
+                a->vminps(ch->reg[c], T0, Y(ch->reg[c]));
+                a->vmaxps(ch->reg[c], ch->reg[c], K(0.0f));
+            }
+            return true;
+
+        case Op::force_opaque:
+            a->vmovups(A, K(1.0f));
+            return true;
+
+        case Op::premul:
+            a->vmulps(r, r, Y(A));
+            a->vmulps(g, g, Y(A));
+            a->vmulps(b, b, Y(A));
+            return true;
+
+        case Op::unpremul:
+            a->vmovups(T0, K(1.0f));
+            a->vdivps(T0, T0, Y(A));
+            a->vcmpps(T1, T0, K(0x7f800000u), CMP_LT_OS);
+            a->vandps(T0, T0, Y(T1));
+            a->vmulps(r, r, Y(T0));
+            a->vmulps(g, g, Y(T0));
+            a->vmulps(b, b, Y(T0));
+            return true;
+
+        case Op::matrix_3x3:
+            matrix(a, ch, &((const skcms_Matrix3x3*)ctx)->vals[0][0], 3);
+            return true;
+
+        case Op::matrix_3x4:
+            matrix(a, ch, &((const skcms_Matrix3x4*)ctx)->vals[0][0], 4);
+            return true;
+
+        case Op::gamma_r:   apply_gamma(a, tf, r); return true;
+        case Op::gamma_g:   apply_gamma(a, tf, g); return true;
+        case Op::gamma_b:   apply_gamma(a, tf, b); return true;
+        case Op::gamma_a:   apply_gamma(a, tf, A); return true;
+        case Op::gamma_rgb:
+            apply_gamma(a, tf, r);
+            apply_gamma(a, tf, g);
+            apply_gamma(a, tf, b);
+            return true;
+
+        case Op::tf_r:   apply_tf(a, tf, r); return true;
+        case Op::tf_g:   apply_tf(a, tf, g); return true;
+        case Op::tf_b:   apply_tf(a, tf, b); return true;
+        case Op::tf_a:   apply_tf(a, tf, A); return true;
+        case Op::tf_rgb:
+            apply_tf(a, tf, r);
+            apply_tf(a, tf, g);
+            apply_tf(a, tf, b);
+            return true;
+
+        case Op::store_8888:
+            *dst_bpp = 4;
+            for (int c = 0; c < 4; c++) {
+                a->vmulps(T1, ch->reg[c], K(255.0f));
+                a->vaddps(T1, T1, K(0.5f));
+                a->vcvttps2dq(T1, T1);
+                if (c == 0) {
+                    a->vmovups(T0, Y(T1));
+                } else {
+                    a->vpslld(T1, T1, 8*c);
+                    a->vorps(T0, T0, Y(T1));
+                }
+            }
+            a->vmovups(M(RSI, 0), T0);
+            return true;
+
+        case Op::store_ffff:
+            // The reverse of load_ffff.
+            *dst_bpp = 16;
+            a->vunpcklps(T0, r, Y(g));
+            a->vunpckhps(T1, r, Y(g));
+            a->vunpcklps(T2, b, Y(A));
+            a->vunpckhps(T3, b, Y(A));
+            a->vunpcklpd(T4, T0, Y(T2));
+            a->vunpckhpd(T5, T0, Y(T2));
+            a->vunpcklpd(T6, T1, Y(T3));
+            a->vunpckhpd(T7, T1, Y(T3));
+            a->vperm2f128(T0, T4, T5, 0x20);
+            a->vperm2f128(T1, T6, T7, 0x20);
+            a->vperm2f128(T2, T4, T5, 0x31);
+            a->vperm2f128(T3, T6, T7, 0x31);
+            for (int k = 0; k < 4; k++) {
+                a->vmovups(M(RSI, 32*k), T0+k);
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool is_load(Op op)  { return op == Op::load_8888  || op == Op::load_ffff;  }
+static bool is_store(Op op) { return op == Op::store_8888 || op == Op::store_ffff; }
+
+bool compile(const Op* program, const void** contexts, ptrdiff_t programSize, Program* out) {
+    if (programSize < 2 || !is_load(program[0]) || !is_store(program[programSize-1])) {
+        return false;
+    }
+
+    Assembler* a = (Assembler*)calloc(1, sizeof(Assembler));
+    if (!a) {
+        return false;
+    }
+    a->ok = true;
+
+    Channels ch;
+    size_t src_bpp = 0,
+           dst_bpp = 0;
+    const size_t loop = a->len;
+    for (ptrdiff_t i = 0; i < programSize; i++) {
+        if (!emit(a, &ch, program[i], contexts[i], &src_bpp, &dst_bpp)) {
+            free(a);
+            return false;
+        }
+    }
+
+    a->add_imm(RDI, (uint32_t)(kStride * src_bpp));
+    a->add_imm(RSI, (uint32_t)(kStride * dst_bpp));
+    a->byte(0x48); a->byte(0xff); a->byte(0xc8 | RDX);                  // dec rdx
+    a->byte(0x0f); a->byte(0x85); a->dword((uint32_t)(loop - (a->len + 4)));  // jnz loop
+    a->byte(0xc5); a->byte(0xf8); a->byte(0x77);                        // vzeroupper
+    a->byte(0xc3);                                                      // ret
+
+    // The constant pool follows the code, 32-byte aligned.
+    const size_t pool = (a->len + 31) & ~(size_t)31,
+                 size = pool + 32 * (size_t)a->nconsts;
+    if (!a->ok) {
+        free(a);
+        return false;
+    }
+
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        free(a);
+        return false;
+    }
+    uint8_t* code = (uint8_t*)mem;
+    memcpy(code, a->code, a->len);
+    memset(code + a->len, 0xcc/*int3*/, pool - a->len);
+    for (int i = 0; i < a->nconsts; i++) {
+        for (int k = 0; k < 8; k++) {
+            memcpy(code + pool + 32*(size_t)i + 4*(size_t)k, &a->consts[i], 4);
+        }
+    }
+    for (int i = 0; i < a->nfixups; i++) {
+        const Assembler::Fixup& f = a->fixups[i];
+        const uint32_t rel = (uint32_t)(pool + 32*(size_t)f.index - f.end);
+        memcpy(code + f.at, &rel, 4);
+    }
+    free(a);
+
+    if (0 != mprotect(mem, size, PROT_READ | PROT_EXEC)) {
+        munmap(mem, size);
+        return false;
+    }
+    out->code = mem;
+    out->size = size;
+    return true;
+}
+
+void run(const Program& program, const char* src, char* dst, size_t n,
+         size_t src_bpp, size_t dst_bpp) {
+    JitFn* fn;
+    memcpy(&fn, &program.code, sizeof(fn));
+    if (n >= kStride) {
+        fn(src, dst, n / kStride);
+    }
+    const size_t done = n - n % kStride;
+    if (done < n) {
+        float tmp[kStride * 4] = {0};  // Room for 8 RGBA_ffff pixels.
+        memcpy(tmp, src + done*src_bpp, (n - done)*src_bpp);
+        fn((const char*)tmp, (char*)tmp, 1);
+        memcpy(dst + done*dst_bpp, tmp, (n - done)*dst_bpp);
+    }
+}
+
+void release(Program* program) {
+    if (program->code) {
+        munmap(program->code, program->size);
+        program->code = nullptr;
+    }
+}
+
+#endif
+
+}  // namespace jit
+}  // namespace skcms_private
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "skcms_public.h"     // NO_G3_REWRITE
+#include "skcms_internals.h"  // NO_G3_REWRITE
+#include "skcms_Transform.h"  // NO_G3_REWRITE
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+    #include <immintrin.h>
+
+    #if defined(__clang__)
+        // That #include <immintrin.h> is usually enough, but Clang's headers
+        // avoid #including the whole kitchen sink when _MSC_VER is defined,
+        // because lots of programs on Windows would include that and it'd be
+        // a lot slower. But we want all those headers included, so we can use
+        // their features (after making runtime checks).
+        #include <tmmintrin.h>
+        #include <smmintrin.h>
+    #endif
+#endif
+
+namespace skcms_private {
+namespace sse41 {
+
+#if defined(SKCMS_DISABLE_SSE41)
+
+void run_program(const Op* program, const void** contexts, ptrdiff_t programSize,
+                 const char* src, char* dst, int n,
+                 size_t src_bpp, size_t dst_bpp) {
+    skcms_private::baseline::run_program(program, contexts, programSize,
+                                         src, dst, n, src_bpp, dst_bpp);
+}
+
+RunProgramFn find_kernel(const Op* program, ptrdiff_t programSize) {
+    return skcms_private::baseline::find_kernel(program, programSize);
+}
+
+void run_byte_luts(const ByteLUTs& luts, const char* src, char* dst, int n,
+                   size_t src_bpp, size_t dst_bpp) {
+    skcms_private::baseline::run_byte_luts(luts, src, dst, n, src_bpp, dst_bpp);
+}
+
+void run_program_lowp(const LowpOp* program, const void** contexts, ptrdiff_t programSize,
+                      const char* src, char* dst, int n,
+                      size_t src_bpp, size_t dst_bpp) {
+    skcms_private::baseline::run_program_lowp(program, contexts, programSize,
+                                              src, dst, n, src_bpp, dst_bpp);
+}
+
+#else
+
+// The same 4-wide program as baseline, but the compiler may use SSSE3 and SSE4.1: pshufb for
+// byte shuffles, blendv for if_then_else(), roundps for floor_(), and so on.
+#define N 4
+template <typename T> using V = skcms_private::Vec<N,T>;
+
+#include "Transform_inl.h"
+
+#endif
+
+}  // namespace sse41
+}  // namespace skcms_private
@@ -21,6 +21,11 @@ extern "C" {
 // skcms can leverage some C++ extensions when they are present.
 #define ARRAY_COUNT(arr) (int)(sizeof((arr)) / sizeof(*(arr)))
 
+#if defined(SKCMS_PROFILE) && !defined(SKCMS_HAS_MUSTTAIL)
+    // Profiling times each stage from the interpreter loop, which tail-calling stages don't have.
+    #define SKCMS_HAS_MUSTTAIL 0
+#endif
+
 #if defined(__has_cpp_attribute)
     #if __has_cpp_attribute(clang::fallthrough)
         #define SKCMS_FALLTHROUGH [[clang::fallthrough]]
@@ -108,9 +113,15 @@ extern "C" {
     #define SKCMS_PORTABLE 1
 #endif
 
-// If we are in SKCMS_PORTABLE mode or running on a non-x86-64 platform, we can't enable HSW or SKX.
-// We also disable HSW/SKX on Android, even if it's Android on x64, since it's unlikely to benefit.
+// If we are in SKCMS_PORTABLE mode or running on a non-x86-64 platform, we can't enable SSE41,
+// HSW, or SKX.  We also disable them on Android, even if it's Android on x64, since it's unlikely
+// to benefit.
 #if defined(SKCMS_PORTABLE) || !defined(__x86_64__) || defined(ANDROID) || defined(__ANDROID__)
+    #undef SKCMS_FORCE_SSE41
+    #if !defined(SKCMS_DISABLE_SSE41)
+        #define SKCMS_DISABLE_SSE41 1
+    #endif
+
     #undef SKCMS_FORCE_HSW
     #if !defined(SKCMS_DISABLE_HSW)
         #define SKCMS_DISABLE_HSW 1
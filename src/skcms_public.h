@@ -281,6 +281,18 @@ SKCMS_API const skcms_TransferFunction* skcms_Identity_TransferFunction(void);
 SKCMS_API bool skcms_ApproximatelyEqualProfiles(const skcms_ICCProfile* A,
                                                 const skcms_ICCProfile* B);
 
+// A 128-bit hash of a profile's parsed contents: its curves (including table contents),
+// matrices, A2B/B2A grids, CICP, and so on.  Pointers and the ICC buffer itself are ignored,
+// so separately parsed copies of the same profile have the same fingerprint.  Fingerprints are
+// meant for cache keys: different profiles can collide, so compare the profiles themselves
+// before treating them as interchangeable.  Fingerprints are not stable across skcms versions.
+typedef struct skcms_Fingerprint {
+    uint64_t lo;
+    uint64_t hi;
+} skcms_Fingerprint;
+
+SKCMS_API skcms_Fingerprint skcms_ProfileFingerprint(const skcms_ICCProfile*);
+
 // Practical test that answers: Is curve roughly the inverse of inv_tf? Typically used by passing
 // the inverse of a known parametric transfer function (like sRGB), to determine if a particular
 // curve is very close to sRGB.
@@ -411,8 +423,56 @@ typedef enum skcms_PixelFormat {
     skcms_PixelFormat_BGR_101010x_XR,    // Compatible with MTLPixelFormatBGR10_XR.
     skcms_PixelFormat_RGBA_10101010_XR,  // Note: This is located here to signal no clamping.
     skcms_PixelFormat_BGRA_10101010_XR,  // Compatible with MTLPixelFormatBGRA10_XR.
+
+    // Planar formats keep each channel in its own plane.  Instead of pointing directly at
+    // pixels, src or dst points to a skcms_PlanarBuffer.  The BGR variants expect the planes
+    // in B,G,R(,A) order.  16-bit samples are little-endian.  Alignment is as above.
+    skcms_PixelFormat_RGB_888_Planar,
+    skcms_PixelFormat_BGR_888_Planar,
+    skcms_PixelFormat_RGBA_8888_Planar,
+    skcms_PixelFormat_BGRA_8888_Planar,
+    skcms_PixelFormat_RGB_161616LE_Planar,
+    skcms_PixelFormat_BGR_161616LE_Planar,
+    skcms_PixelFormat_RGBA_16161616LE_Planar,
+    skcms_PixelFormat_BGRA_16161616LE_Planar,
+    skcms_PixelFormat_RGB_hhh_Planar,
+    skcms_PixelFormat_BGR_hhh_Planar,
+    skcms_PixelFormat_RGBA_hhhh_Planar,
+    skcms_PixelFormat_BGRA_hhhh_Planar,
+    skcms_PixelFormat_RGB_fff_Planar,
+    skcms_PixelFormat_BGR_fff_Planar,
+    skcms_PixelFormat_RGBA_ffff_Planar,
+    skcms_PixelFormat_BGRA_ffff_Planar,
+
+    // YCbCr source formats, also through a skcms_PlanarBuffer.  The source profile's CICP
+    // matrix_coefficients (BT.601, BT.709, BT.2020, or identity) and video_full_range_flag
+    // choose how to convert to R'G'B'.  Profiles without CICP are treated as limited-range BT.709.
+    // Chroma is upsampled by replication.  The CrCb variants swap the two chroma channels.
+    // 16-bit samples are little-endian with their significant bits at the top, as in P010.
+    skcms_PixelFormat_YCbCr_444_888,    // 3 planes: Y, Cb, Cr.
+    skcms_PixelFormat_YCrCb_444_888,
+    skcms_PixelFormat_YCbCr_444_161616,
+    skcms_PixelFormat_YCrCb_444_161616,
+    skcms_PixelFormat_YCbCr_422_888,    // 3 planes, chroma at half width, e.g. I422.
+    skcms_PixelFormat_YCrCb_422_888,
+    skcms_PixelFormat_YCbCr_420_888,    // 3 planes, chroma at half width and height, e.g. I420.
+    skcms_PixelFormat_YCrCb_420_888,    // e.g. YV12.
+    skcms_PixelFormat_YCbCr_420_88,     // 2 planes: Y, then interleaved CbCr pairs, e.g. NV12.
+    skcms_PixelFormat_YCrCb_420_88,     // e.g. NV21.
+    skcms_PixelFormat_YCbCr_420_1616,   // e.g. P010, P016.
+    skcms_PixelFormat_YCrCb_420_1616,
 } skcms_PixelFormat;
 
+// Pixel i's first channel is at planes[0] + i * (bytes per sample), its second in planes[1], etc.
+// Alpha, if the format has it, always comes last.  Unused planes are ignored.
+//
+// For the 2D entry points, rows in plane p are strides[p] bytes apart, or the srcStride or
+// dstStride argument if strides[p] is 0.  Chroma planes of 4:2:0 formats have half as many rows.
+typedef struct skcms_PlanarBuffer {
+    void*  planes[4];
+    size_t strides[4];
+} skcms_PlanarBuffer;
+
 // We always store any alpha channel linearly.  In the chart below, tf-1() is the inverse
 // transfer function for the given color profile (applying the transfer function linearizes).
 
@@ -444,6 +504,181 @@ SKCMS_API bool skcms_Transform(const void*             src,
                                const skcms_ICCProfile* dstProfile,
                                size_t                  npixels);
 
+// A compiled transform does all the work skcms_Transform() does with its format, alpha, and
+// profile arguments once, up front, so that it can then be run cheaply over many spans of pixels.
+typedef struct skcms_CompiledTransform skcms_CompiledTransform;
+
+// Returns null wherever skcms_Transform() would fail for these arguments, regardless of pixels.
+// The profiles (and their ICC buffers) are copied, so they need not outlive the transform.
+// A compiled transform is immutable, and safe to run from multiple threads at once.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreate(skcms_PixelFormat       srcFmt,
+                                                         skcms_AlphaFormat       srcAlpha,
+                                                         const skcms_ICCProfile* srcProfile,
+                                                         skcms_PixelFormat       dstFmt,
+                                                         skcms_AlphaFormat       dstAlpha,
+                                                         const skcms_ICCProfile* dstProfile);
+
+// Equivalent to calling skcms_Transform() with the arguments used to create this transform.
+// Only transforms created to trade accuracy for speed, with simplex interpolation, baked, or
+// lowp, may differ.
+SKCMS_API bool skcms_TransformRun(const skcms_CompiledTransform*,
+                                  const void* src,
+                                  void*       dst,
+                                  size_t      npixels);
+
+SKCMS_API void skcms_TransformDestroy(skcms_CompiledTransform*);
+
+// How to interpolate between the grid points of A2B and B2A CLUTs.  Multilinear blends all 2^N
+// corners of the grid cell around each color (8 for RGB, 16 for CMYK).  Simplex blends only the
+// N+1 corners of the tetrahedron (or for CMYK, pentatope) around it, which is quicker, and
+// usually about as accurate.  The two agree exactly at grid points.
+typedef enum skcms_Interpolation {
+    skcms_Interpolation_Multilinear,
+    skcms_Interpolation_Simplex,
+} skcms_Interpolation;
+
+// Like skcms_TransformCreate(), choosing how to interpolate CLUTs.  skcms_TransformCreate() and
+// skcms_Transform() always interpolate multilinearly.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreateWithInterpolation(
+        skcms_PixelFormat       srcFmt,
+        skcms_AlphaFormat       srcAlpha,
+        const skcms_ICCProfile* srcProfile,
+        skcms_PixelFormat       dstFmt,
+        skcms_AlphaFormat       dstAlpha,
+        const skcms_ICCProfile* dstProfile,
+        skcms_Interpolation     interpolation);
+
+// How compiled transforms read the grids of A2B and B2A CLUTs.  ICC reads them where they are in
+// the profile: big-endian, with 3 or 4 channels per entry.  Packed copies them once into the
+// transform, native-endian and padded to 4 channels, so that each corner is one aligned load.
+// This costs up to another 8 bytes per grid entry, usually repaid by transforms of large images.
+// Blocked packs the same way, then also tiles the grid into small blocks in Z-order, so that the
+// corners of each cell (16 for CMYK) tend to share cache lines rather than sit a row apart.
+typedef enum skcms_CLUTLayout {
+    skcms_CLUTLayout_ICC,
+    skcms_CLUTLayout_Packed,
+    skcms_CLUTLayout_Blocked,
+} skcms_CLUTLayout;
+
+// Like skcms_TransformCreate(), choosing how to lay out CLUTs.  Other compiled transforms and
+// skcms_Transform() always use skcms_CLUTLayout_ICC.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreateWithCLUTLayout(
+        skcms_PixelFormat       srcFmt,
+        skcms_AlphaFormat       srcAlpha,
+        const skcms_ICCProfile* srcProfile,
+        skcms_PixelFormat       dstFmt,
+        skcms_AlphaFormat       dstAlpha,
+        const skcms_ICCProfile* dstProfile,
+        skcms_CLUTLayout        layout);
+
+// Like skcms_TransformCreate(), but samples the whole color conversion once into a
+// gridPoints^3 lattice, so that each pixel then costs a single tetrahedral interpolation, however
+// complex the profiles.  This trades some accuracy for speed, most of all with A2B or B2A
+// profiles.  Only RGB_888 and RGBA_8888 formats (and their BGR variants) are supported, with
+// gridPoints in [2,65]; 17 or 33 are typical.
+//
+// If maxError is not null, it's set to the largest difference between the baked and exact
+// transforms over every fifth code value of each source channel, in 8-bit steps before
+// rounding.  Less than 1 means the two will mostly round to the same bytes.  Expect the most
+// error where the conversion clips colors outside the destination gamut.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreateBaked(skcms_PixelFormat       srcFmt,
+                                                              skcms_AlphaFormat       srcAlpha,
+                                                              const skcms_ICCProfile* srcProfile,
+                                                              skcms_PixelFormat       dstFmt,
+                                                              skcms_AlphaFormat       dstAlpha,
+                                                              const skcms_ICCProfile* dstProfile,
+                                                              int                     gridPoints,
+                                                              float*                  maxError);
+
+// Like skcms_TransformCreate(), but transforms between 8-bit formats (RGB_888, RGBA_8888, and
+// their BGR variants) through only curves and matrices run in 16-bit fixed point, about twice as
+// fast, with bytes up to 1 away from skcms_Transform()'s.  Other transforms, and every transform
+// on the AVX-512 backend, run just as skcms_TransformCreate()'s would.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreateLowp(skcms_PixelFormat       srcFmt,
+                                                             skcms_AlphaFormat       srcAlpha,
+                                                             const skcms_ICCProfile* srcProfile,
+                                                             skcms_PixelFormat       dstFmt,
+                                                             skcms_AlphaFormat       dstAlpha,
+                                                             const skcms_ICCProfile* dstProfile);
+
+// Calls task(task_ctx, i) exactly once for each i in [0,count), in any order and on any threads,
+// returning only once all those calls have finished.
+typedef void skcms_TaskRunner(void* runner_ctx,
+                              int   count,
+                              void (*task)(void* task_ctx, int i),
+                              void* task_ctx);
+
+// Like skcms_TransformRun(), but splits large spans of pixels into cache-sized chunks and runs
+// them with the given task runner, typically backed by the caller's own thread pool.
+// Spans too small to be worth splitting, or a null runner, run on the calling thread.
+SKCMS_API bool skcms_TransformRunWithRunner(const skcms_CompiledTransform*,
+                                            const void*       src,
+                                            void*             dst,
+                                            size_t            npixels,
+                                            skcms_TaskRunner* runner,
+                                            void*             runner_ctx);
+
+// Like skcms_TransformRunWithRunner(), using threads started just for this call, including the
+// calling thread.  threads <= 0 means one per hardware thread.
+SKCMS_API bool skcms_TransformRunParallel(const skcms_CompiledTransform*,
+                                          const void* src,
+                                          void*       dst,
+                                          size_t      npixels,
+                                          int         threads);
+
+// Transforms a width x height image whose rows start every srcStride and dstStride bytes,
+// building the transform program only once for the whole image.  Strides must be at least a
+// full row of pixels.  Transforming in place requires equal strides and pixel sizes.
+SKCMS_API bool skcms_TransformImage(const void*             src,
+                                    skcms_PixelFormat       srcFmt,
+                                    skcms_AlphaFormat       srcAlpha,
+                                    const skcms_ICCProfile* srcProfile,
+                                    size_t                  srcStride,
+                                    void*                   dst,
+                                    skcms_PixelFormat       dstFmt,
+                                    skcms_AlphaFormat       dstAlpha,
+                                    const skcms_ICCProfile* dstProfile,
+                                    size_t                  dstStride,
+                                    int                     width,
+                                    int                     height);
+
+// The same, with an already compiled transform, optionally split into bands of rows and run
+// with a skcms_TaskRunner.
+SKCMS_API bool skcms_TransformRunImage(const skcms_CompiledTransform*,
+                                       const void* src, size_t srcStride,
+                                       void*       dst, size_t dstStride,
+                                       int width, int height);
+SKCMS_API bool skcms_TransformRunImageWithRunner(const skcms_CompiledTransform*,
+                                                 const void* src, size_t srcStride,
+                                                 void*       dst, size_t dstStride,
+                                                 int width, int height,
+                                                 skcms_TaskRunner* runner, void* runner_ctx);
+
+// Like skcms_Transform(), but compiles each distinct set of formats and profiles only once,
+// remembering the most recently used few dozen compiled transforms in a global, thread-safe cache.
+// Profiles are matched by content, so separately parsed copies of the same profile share an entry.
+SKCMS_API bool skcms_TransformCached(const void*             src,
+                                     skcms_PixelFormat       srcFmt,
+                                     skcms_AlphaFormat       srcAlpha,
+                                     const skcms_ICCProfile* srcProfile,
+                                     void*                   dst,
+                                     skcms_PixelFormat       dstFmt,
+                                     skcms_AlphaFormat       dstAlpha,
+                                     const skcms_ICCProfile* dstProfile,
+                                     size_t                  npixels);
+
+typedef struct skcms_TransformCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} skcms_TransformCacheStats;
+
+// Counts accumulated by skcms_TransformCached() since the process started.
+SKCMS_API skcms_TransformCacheStats skcms_GetTransformCacheStats(void);
+
+// Drops every cached transform.  Calls already running with one will finish normally.
+SKCMS_API void skcms_PurgeTransformCache(void);
+
 // If profile can be used as a destination in skcms_Transform, return true. Otherwise, attempt to
 // rewrite it with approximations where reasonable. If successful, return true. If no reasonable
 // approximation exists, leave the profile unchanged and return false.
@@ -467,9 +702,81 @@ SKCMS_API bool skcms_PrimariesToXYZD50(float rx, float ry,
                                        float wx, float wy,
                                        skcms_Matrix3x3* toXYZD50);
 
+// skcms simplifies each transform's program of operations before running it.  For debugging,
+// fn(ctx, opsBefore, opsAfter) is called each time that happens, until called with null fn.
+// The hook is not synchronized: set or clear it only while no other thread is building or
+// running transforms, e.g. before the first.
+typedef void skcms_OptimizerHook(void* ctx, int opsBefore, int opsAfter);
+SKCMS_API void skcms_SetOptimizerHook(skcms_OptimizerHook* fn, void* ctx);
+
 // Call before your first call to skcms_Transform() to skip runtime CPU detection.
 SKCMS_API void skcms_DisableRuntimeCPUDetection(void);
 
+// The SIMD backends skcms can run transforms with, from least to most capable.  Each needs a CPU
+// supporting it, and not to have been compiled out (e.g. with SKCMS_DISABLE_HSW).  HSW transforms
+// may run JIT-compiled code instead of interpreting, with identical results.
+typedef enum skcms_Backend {
+    skcms_Backend_Auto,      // The best backend this CPU supports.
+    skcms_Backend_Baseline,  // SSE2 on x86-64, NEON on ARM64, or portable C.
+    skcms_Backend_SSE41,     // SSSE3 and SSE4.1.
+    skcms_Backend_HSW,       // AVX2 and F16C.
+    skcms_Backend_SKX,       // AVX-512.
+} skcms_Backend;
+
+// Returns true if transforms can run with this backend here.  Auto and Baseline always can.
+SKCMS_API bool skcms_IsBackendAvailable(skcms_Backend);
+
+// Choose the backend for transforms created from now on, returning false (and changing nothing)
+// if it's unavailable.  Auto restores the default: the backend named by the SKCMS_BACKEND
+// environment variable ("baseline", "sse41", "hsw", or "skx") if set and available, otherwise
+// the best available.  Transforms already created keep their backend.
+SKCMS_API bool skcms_SetBackend(skcms_Backend);
+
+// The backend new transforms will use, never Auto.
+SKCMS_API skcms_Backend skcms_GetBackend(void);
+
+// Like skcms_TransformCreate(), running with the given backend regardless of skcms_SetBackend().
+// Returns null if that backend is unavailable.
+SKCMS_API skcms_CompiledTransform* skcms_TransformCreateWithBackend(
+        skcms_PixelFormat       srcFmt,
+        skcms_AlphaFormat       srcAlpha,
+        const skcms_ICCProfile* srcProfile,
+        skcms_PixelFormat       dstFmt,
+        skcms_AlphaFormat       dstAlpha,
+        const skcms_ICCProfile* dstProfile,
+        skcms_Backend           backend);
+
+// The backend this transform runs with, never Auto.
+SKCMS_API skcms_Backend skcms_TransformGetBackend(const skcms_CompiledTransform*);
+
+// What a compiled transform runs: its ops in order after skcms has simplified them, each with a
+// short summary of its parameters ("" for ops without any), e.g. "tf_rgb  g=2.4 a=0.948 ...".
+// path is how they're run: "byte LUTs", "lowp", "JIT", "kernel", or "interpreter", the slowest.
+typedef struct skcms_TransformDescription {
+    skcms_Backend backend;
+    const char*   path;
+    int           op_count;
+    const char*   ops[32];
+    char          contexts[32][128];
+} skcms_TransformDescription;
+
+SKCMS_API void skcms_DescribeTransform(const skcms_CompiledTransform*,
+                                       skcms_TransformDescription*);
+
+// When built with SKCMS_PROFILE defined, skcms times each op of every transform it runs.  To
+// see every op, those builds skip the paths that would hide them: byte lookup tables, lowp, the
+// JIT, specialized kernels, and fused ops.  Otherwise nothing is timed, at no cost.
+typedef struct skcms_StageProfile {
+    const char* name;   // The op, e.g. "load_8888" or "clut_A2B".
+    uint64_t    calls;  // How many times it ran, each time over a handful of pixels.
+    uint64_t    ticks;  // Time spent: timestamp counter ticks on x86-64, nanoseconds elsewhere.
+} skcms_StageProfile;
+
+// Fills stages with up to count of the ops that have run since the last reset, in no particular
+// order, and returns how many have run, which is always 0 without SKCMS_PROFILE.
+SKCMS_API int  skcms_GetStageProfile(skcms_StageProfile* stages, int count);
+SKCMS_API void skcms_ResetStageProfile(void);
+
 // Utilities for programmatically constructing profiles
 static inline void skcms_Init(skcms_ICCProfile* p) {
     memset(p, 0, sizeof(*p));
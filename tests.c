@@ -2144,6 +2144,139 @@ static void test_ParseWithA2BPriority(void) {
     free(ptr);
 }
 
+static void test_CLUT_Simplex(void) {
+    // A CLUT sampling an affine function interpolates that function exactly either way, so
+    // simplex and multilinear interpolation should agree (up to the grid's 16-bit rounding).
+    //
+    // A 2-point grid that's 1 at its top corner and 0 elsewhere tells them apart: multilinear
+    // interpolation gives the product of the inputs, and simplex interpolation their minimum.
+    for (int corner = 0; corner < 2; corner++)
+    for (int dim = 3; dim <= 4; dim++) {
+        const int points = corner ? 2 : dim == 3 ? 5 : 3;
+        uint8_t grid[3 * 5*5*5 * 2];
+
+        // Output channel c is the sum over input channels k of coef(c,k) * input k.
+        #define coef(c,k) ((float)(1 + ((c) + (k)) % 3) / (float)(3*dim))
+        int entries = 1;
+        for (int k = 0; k < dim; k++) {
+            entries *= points;
+        }
+        for (int e = 0; e < entries; e++)
+        for (int c = 0; c < 3; c++) {
+            // The first input varies slowest.
+            float v = 0;
+            for (int k = dim-1, rest = e; k >= 0; k--, rest /= points) {
+                v += coef(c,k) * (float)(rest % points) / (float)(points-1);
+            }
+            if (corner) {
+                v = e == entries-1 ? 1.0f : 0.0f;
+            }
+            uint16_t v16 = (uint16_t)(v * 65535 + 0.5f);
+            grid[2*(3*e+c)+0] = (uint8_t)(v16 >> 8);  // Big-endian.
+            grid[2*(3*e+c)+1] = (uint8_t)(v16 >> 0);
+        }
+
+        skcms_ICCProfile profile = *skcms_XYZD50_profile();
+        skcms_TransferFunction identity = { 1, 1, 0, 0, 0, 0, 0 };
+        profile.data_color_space = dim == 3 ? skcms_Signature_RGB : skcms_Signature_CMYK;
+        profile.pcs              = skcms_Signature_XYZ;
+        profile.has_A2B          = true;
+        memset(&profile.A2B, 0, sizeof(profile.A2B));
+        profile.A2B.input_channels  = (uint32_t)dim;
+        profile.A2B.output_channels = 3;
+        profile.A2B.grid_16         = grid;
+        for (int k = 0; k < 4; k++) {
+            profile.A2B.grid_points[k]            = (uint8_t)(k < dim ? points : 0);
+            profile.A2B.input_curves[k].parametric = identity;
+        }
+        for (int c = 0; c < 3; c++) {
+            profile.A2B.output_curves[c].parametric = identity;
+        }
+
+        const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+        skcms_CompiledTransform* multilinear = skcms_TransformCreateWithInterpolation(
+                skcms_PixelFormat_RGBA_ffff, upm, &profile,
+                skcms_PixelFormat_RGB_fff,   upm, skcms_XYZD50_profile(),
+                skcms_Interpolation_Multilinear);
+        skcms_CompiledTransform* simplex = skcms_TransformCreateWithInterpolation(
+                skcms_PixelFormat_RGBA_ffff, upm, &profile,
+                skcms_PixelFormat_RGB_fff,   upm, skcms_XYZD50_profile(),
+                skcms_Interpolation_Simplex);
+        expect(multilinear && simplex);
+
+        enum { kPixels = 252/4 };
+        float src[4*kPixels], want[3*kPixels], got[3*kPixels];
+        for (int i = 0; i < 4*kPixels; i++) {
+            src[i] = skcms_252_random_bytes[i] * (1/255.0f);
+        }
+        expect(skcms_TransformRun(multilinear, src, want, kPixels));
+        expect(skcms_TransformRun(simplex,     src, got , kPixels));
+        for (int i = 0; i < kPixels; i++)
+        for (int c = 0; c < 3; c++) {
+            // skcms reads CMYK as inverted, the way Photoshop writes it.
+            float affine = 0, product = 1, minimum = 1;
+            for (int k = 0; k < dim; k++) {
+                const float x = dim == 4 ? 1 - src[4*i+k] : src[4*i+k];
+                affine += coef(c,k) * x;
+                product *= x;
+                minimum  = x < minimum ? x : minimum;
+            }
+            if (corner) {
+                expect(fabsf_(want[3*i+c] - product) < 0.0005f);
+                expect(fabsf_(got [3*i+c] - minimum) < 0.0005f);
+            } else {
+                expect(fabsf_(got[3*i+c] - want[3*i+c]) < 0.0002f);
+                expect(fabsf_(got[3*i+c] - affine     ) < 0.0005f);
+            }
+        }
+        #undef coef
+        skcms_TransformDestroy(multilinear);
+        skcms_TransformDestroy(simplex);
+    }
+
+    // Real CLUTs aren't affine, but the two should still mostly agree.
+    const char* filenames[] = {
+        "profiles/misc/Coated_FOGRA39_CMYK.icc",
+        "profiles/color.org/sRGB_ICC_v4_Appearance.icc",
+    };
+    for (int f = 0; f < ARRAY_COUNT(filenames); f++) {
+        void*  ptr;
+        size_t len;
+        skcms_ICCProfile profile;
+        expect(load_file(filenames[f], &ptr, &len));
+        expect(skcms_Parse(ptr, len, &profile));
+
+        // Exercise the A2B (source) and B2A (destination) CLUTs.
+        for (int dst = 0; dst < 2; dst++) {
+            const skcms_ICCProfile* src_profile = dst ? NULL : &profile;
+            const skcms_ICCProfile* dst_profile = dst ? &profile : NULL;
+            const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+            skcms_CompiledTransform* multilinear = skcms_TransformCreateWithInterpolation(
+                    skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                    skcms_PixelFormat_RGBA_8888, upm, dst_profile,
+                    skcms_Interpolation_Multilinear);
+            skcms_CompiledTransform* simplex = skcms_TransformCreateWithInterpolation(
+                    skcms_PixelFormat_RGBA_8888, upm, src_profile,
+                    skcms_PixelFormat_RGBA_8888, upm, dst_profile,
+                    skcms_Interpolation_Simplex);
+            expect(multilinear && simplex);
+
+            uint8_t want[252], got[252];
+            expect(skcms_TransformRun(multilinear, skcms_252_random_bytes, want, 252/4));
+            expect(skcms_TransformRun(simplex,     skcms_252_random_bytes, got , 252/4));
+            int total = 0;
+            for (int i = 0; i < 252; i++) {
+                total += abs(got[i] - want[i]);
+            }
+            expect(total < 252);  // i.e. off by less than one on average.
+
+            skcms_TransformDestroy(multilinear);
+            skcms_TransformDestroy(simplex);
+        }
+        free(ptr);
+    }
+}
+
 static void test_CLUT_PageBoundary(void) {
 #if !defined(_MSC_VER)
     // This test ensures that skcms does not read memory before the provided CLUT buffer.
@@ -2372,6 +2505,1474 @@ static void test_B2A(void) {
     free(ptr);
 }
 
+static void test_CompiledTransform(void) {
+    const char* filenames[] = {
+        "profiles/color.org/Upper_Left.icc",           // A2B and B2A, with 16-bit grids.
+        "profiles/misc/MartiMaria_browsertest_A2B.icc",
+        "profiles/mobile/sRGB_LUT.icc",                // Table-based TRC.
+    };
+    const uint8_t* src = skcms_252_random_bytes;
+
+    for (int i = 0; i < ARRAY_COUNT(filenames); i++) {
+        void*  ptr;
+        size_t len;
+        expect(load_file(filenames[i], &ptr, &len));
+
+        skcms_ICCProfile profile;
+        expect(skcms_Parse(ptr, len, &profile));
+
+        uint8_t want_from[252], want_to[252];
+        expect(skcms_Transform(src,       skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                               &profile,
+                               want_from, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                               skcms_sRGB_profile(),
+                               252/4));
+        bool to_ok = skcms_Transform(src,     skcms_PixelFormat_RGBA_8888,
+                                     skcms_AlphaFormat_Unpremul, skcms_sRGB_profile(),
+                                     want_to, skcms_PixelFormat_RGBA_8888,
+                                     skcms_AlphaFormat_Unpremul, &profile,
+                                     252/4);
+
+        skcms_CompiledTransform* from = skcms_TransformCreate(
+                skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &profile,
+                skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, skcms_sRGB_profile());
+        skcms_CompiledTransform* to = skcms_TransformCreate(
+                skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, skcms_sRGB_profile(),
+                skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &profile);
+        expect(from);
+        expect(to_ok == (to != NULL));
+
+        // The compiled transforms must not depend on the profile or its buffer any more.
+        memset(ptr, 0xff, len);
+        free(ptr);
+        memset(&profile, 0xff, sizeof(profile));
+
+        // Run each transform a few times, over spans of different lengths.
+        for (int n = 1; n <= 252/4; n += 31) {
+            uint8_t got[252];
+            expect(skcms_TransformRun(from, src, got, (size_t)n));
+            expect(0 == memcmp(got, want_from, (size_t)n*4));
+
+            if (to) {
+                expect(skcms_TransformRun(to, src, got, (size_t)n));
+                expect(0 == memcmp(got, want_to, (size_t)n*4));
+            }
+        }
+        skcms_TransformDestroy(from);
+        skcms_TransformDestroy(to);
+    }
+
+    // We can't create a transform that skcms_Transform() couldn't run.
+    skcms_ICCProfile empty;
+    skcms_Init(&empty);
+    expect(!skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &empty,
+                                  skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL));
+
+    // Null profiles default to sRGB, and in-place aliasing follows skcms_Transform()'s rules.
+    skcms_CompiledTransform* convert = skcms_TransformCreate(
+            skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL,
+            skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul, NULL);
+    expect(convert);
+    uint8_t px[4] = { 1, 2, 3, 4 };
+    expect(skcms_TransformRun(convert, px, px, 1));
+    expect(px[0] == 3 && px[1] == 2 && px[2] == 1 && px[3] == 4);
+    skcms_TransformDestroy(convert);
+
+    convert = skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL,
+                                    skcms_PixelFormat_RGB_888,   skcms_AlphaFormat_Unpremul, NULL);
+    expect(convert);
+    expect(!skcms_TransformRun(convert, px, px, 1));
+    skcms_TransformDestroy(convert);
+}
+
+static void test_TransformCache(void) {
+    skcms_PurgeTransformCache();
+    const skcms_TransformCacheStats before = skcms_GetTransformCacheStats();
+
+    // Two separately parsed copies of the same profile should share one cache entry.
+    void*  ptr[2];
+    size_t len[2];
+    skcms_ICCProfile profile[2];
+    for (int i = 0; i < 2; i++) {
+        expect(load_file("profiles/misc/MartiMaria_browsertest_A2B.icc", &ptr[i], &len[i]));
+        expect(skcms_Parse(ptr[i], len[i], &profile[i]));
+    }
+
+    const uint8_t* src = skcms_252_random_bytes;
+    uint8_t want[252], got[252];
+    expect(skcms_Transform(src,  skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                           &profile[0],
+                           want, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                           skcms_sRGB_profile(),
+                           252/4));
+    for (int i = 0; i < 2; i++) {
+        memset(got, 0, sizeof(got));
+        expect(skcms_TransformCached(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                     &profile[i],
+                                     got, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                     skcms_sRGB_profile(),
+                                     252/4));
+        expect(0 == memcmp(got, want, sizeof(want)));
+    }
+
+    skcms_TransformCacheStats stats = skcms_GetTransformCacheStats();
+    expect(stats.misses - before.misses == 1);
+    expect(stats.hits   - before.hits   == 1);
+
+    // A different alpha format is a different transform.
+    expect(skcms_TransformCached(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                 &profile[1],
+                                 got, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_PremulAsEncoded,
+                                 skcms_sRGB_profile(),
+                                 252/4));
+    stats = skcms_GetTransformCacheStats();
+    expect(stats.misses - before.misses == 2);
+
+    // So is a profile that differs only in the contents of its CLUT.
+    expect(profile[1].has_A2B && profile[1].A2B.input_channels);
+    uint8_t* grid = (uint8_t*)(profile[1].A2B.grid_8 ? profile[1].A2B.grid_8
+                                                     : profile[1].A2B.grid_16);
+    grid[0] ^= 0xff;
+    expect(skcms_Transform(src,  skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                           &profile[1],
+                           want, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                           skcms_sRGB_profile(),
+                           252/4));
+    expect(skcms_TransformCached(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                 &profile[1],
+                                 got, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                 skcms_sRGB_profile(),
+                                 252/4));
+    expect(0 == memcmp(got, want, sizeof(want)));
+    stats = skcms_GetTransformCacheStats();
+    expect(stats.misses - before.misses == 3);
+
+    for (int i = 0; i < 2; i++) {
+        free(ptr[i]);
+    }
+
+    // Failures aren't cached, but are still reported.
+    skcms_ICCProfile empty;
+    skcms_Init(&empty);
+    expect(!skcms_TransformCached(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                  &empty,
+                                  got, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                  NULL,
+                                  1));
+
+    // Many more distinct transforms than the cache can hold force evictions.
+    for (int sf = skcms_PixelFormat_RGBA_8888; sf <= skcms_PixelFormat_RGBA_ffff; sf++)
+    for (int df = skcms_PixelFormat_RGBA_8888; df <= skcms_PixelFormat_RGBA_ffff; df++) {
+        expect(skcms_TransformCached(src, (skcms_PixelFormat)sf, skcms_AlphaFormat_Unpremul, NULL,
+                                     got, (skcms_PixelFormat)df, skcms_AlphaFormat_Unpremul, NULL,
+                                     1));
+    }
+    stats = skcms_GetTransformCacheStats();
+    expect(stats.evictions > before.evictions);
+
+    skcms_PurgeTransformCache();
+}
+
+static bool fingerprints_equal(skcms_Fingerprint a, skcms_Fingerprint b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+static void test_ProfileFingerprint(void) {
+    const char* filenames[] = {
+        "profiles/color.org/Upper_Left.icc",
+        "profiles/misc/MartiMaria_browsertest_A2B.icc",
+        "profiles/mobile/sRGB_LUT.icc",
+        "profiles/mobile/sRGB_parametric.icc",
+        "profiles/mobile/Display_P3_parametric.icc",
+    };
+    skcms_Fingerprint fps[ARRAY_COUNT(filenames)];
+
+    for (int i = 0; i < ARRAY_COUNT(filenames); i++) {
+        // Two copies of the same profile, parsed from two different buffers.
+        void*  ptr[2];
+        size_t len[2];
+        skcms_ICCProfile profile[2];
+        for (int j = 0; j < 2; j++) {
+            expect(load_file(filenames[i], &ptr[j], &len[j]));
+            expect(skcms_Parse(ptr[j], len[j], &profile[j]));
+        }
+        fps[i] = skcms_ProfileFingerprint(&profile[0]);
+        expect(fingerprints_equal(fps[i], skcms_ProfileFingerprint(&profile[1])));
+        expect(skcms_ApproximatelyEqualProfiles(&profile[0], &profile[1]));
+
+        // Any change to the parsed contents should change the fingerprint.
+        profile[1].has_CICP = !profile[1].has_CICP;
+        expect(!fingerprints_equal(fps[i], skcms_ProfileFingerprint(&profile[1])));
+
+        free(ptr[0]);
+        free(ptr[1]);
+    }
+
+    for (int i = 0; i < ARRAY_COUNT(filenames); i++)
+    for (int j = 0; j < i; j++) {
+        expect(!fingerprints_equal(fps[i], fps[j]));
+    }
+
+    // A single different table entry changes the fingerprint.
+    uint8_t table[2][256];
+    for (int i = 0; i < 256; i++) {
+        table[0][i] = table[1][i] = (uint8_t)i;
+    }
+    table[1][128]++;
+
+    skcms_ICCProfile p[2];
+    for (int j = 0; j < 2; j++) {
+        skcms_Init(&p[j]);
+        skcms_SetXYZD50(&p[j], &skcms_sRGB_profile()->toXYZD50);
+        p[j].has_trc = true;
+        for (int c = 0; c < 3; c++) {
+            p[j].trc[c].table_entries = 256;
+            p[j].trc[c].table_8       = table[j];
+        }
+    }
+    expect(!fingerprints_equal(skcms_ProfileFingerprint(&p[0]), skcms_ProfileFingerprint(&p[1])));
+    p[1].trc[0].table_8 = p[1].trc[1].table_8 = p[1].trc[2].table_8 = table[0];
+    expect( fingerprints_equal(skcms_ProfileFingerprint(&p[0]), skcms_ProfileFingerprint(&p[1])));
+}
+
+typedef struct {
+    int calls;
+    int tasks;
+} ReverseRunner;
+
+// A skcms_TaskRunner that runs every task backwards on the calling thread.
+static void run_tasks_in_reverse(void* runner_ctx, int count,
+                                 void (*task)(void* task_ctx, int i), void* task_ctx) {
+    ReverseRunner* runner = (ReverseRunner*)runner_ctx;
+    runner->calls++;
+    runner->tasks += count;
+    for (int i = count - 1; i >= 0; i--) {
+        task(task_ctx, i);
+    }
+}
+
+static void test_TransformParallel(void) {
+    void*  ptr;
+    size_t len;
+    expect(load_file("profiles/misc/MartiMaria_browsertest_A2B.icc", &ptr, &len));
+    skcms_ICCProfile profile;
+    expect(skcms_Parse(ptr, len, &profile));
+
+    skcms_CompiledTransform* xform = skcms_TransformCreate(
+            skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &profile,
+            skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, skcms_sRGB_profile());
+    expect(xform);
+
+    // Enough pixels to split into a few uneven chunks.
+    const int N = 300001;
+    uint8_t* src  = malloc(4*(size_t)N);
+    uint8_t* want = malloc(4*(size_t)N);
+    uint8_t* got  = malloc(4*(size_t)N);
+    expect(src && want && got);
+    for (int i = 0; i < 4*N; i++) {
+        src[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+    expect(skcms_TransformRun(xform, src, want, (size_t)N));
+
+    for (int threads = 0; threads <= 4; threads++) {
+        memset(got, 0, 4*(size_t)N);
+        expect(skcms_TransformRunParallel(xform, src, got, (size_t)N, threads));
+        expect(0 == memcmp(got, want, 4*(size_t)N));
+    }
+
+    ReverseRunner runner = {0, 0};
+    memset(got, 0, 4*(size_t)N);
+    expect(skcms_TransformRunWithRunner(xform, src, got, (size_t)N,
+                                        run_tasks_in_reverse, &runner));
+    expect(0 == memcmp(got, want, 4*(size_t)N));
+    expect(runner.calls == 1 && runner.tasks > 1);
+
+    // Small spans stay on the calling thread.
+    memset(got, 0, 4*(size_t)N);
+    expect(skcms_TransformRunWithRunner(xform, src, got, 1000, run_tasks_in_reverse, &runner));
+    expect(0 == memcmp(got, want, 4*1000));
+    expect(runner.calls == 1);
+
+    free(src);
+    free(want);
+    free(got);
+    skcms_TransformDestroy(xform);
+    free(ptr);
+}
+
+static void test_TransformImage(void) {
+    void*  ptr;
+    size_t len;
+    expect(load_file("profiles/misc/MartiMaria_browsertest_A2B.icc", &ptr, &len));
+    skcms_ICCProfile profile;
+    expect(skcms_Parse(ptr, len, &profile));
+
+    // RGBA_8888 rows padded by 12 bytes in, RGB_888 rows padded by 5 bytes out.
+    const int W = 100, H = 1500;
+    const size_t src_stride = 4*W + 12,
+                 dst_stride = 3*W + 5;
+    uint8_t* src  = malloc(src_stride * H);
+    uint8_t* want = malloc(dst_stride * H);
+    uint8_t* got  = malloc(dst_stride * H);
+    expect(src && want && got);
+    for (size_t i = 0; i < src_stride * H; i++) {
+        src[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+
+    memset(want, 0xab, dst_stride * H);
+    for (int y = 0; y < H; y++) {
+        expect(skcms_Transform(src  + (size_t)y * src_stride,
+                               skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &profile,
+                               want + (size_t)y * dst_stride,
+                               skcms_PixelFormat_RGB_888,   skcms_AlphaFormat_Unpremul, NULL,
+                               W));
+    }
+
+    // Just a few rows, then the whole image, leaving the padding between rows untouched.
+    for (int h = 3; h <= H; h += H-3) {
+        memset(got, 0xab, dst_stride * H);
+        expect(skcms_TransformImage(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                    &profile, src_stride,
+                                    got, skcms_PixelFormat_RGB_888,   skcms_AlphaFormat_Unpremul,
+                                    NULL,     dst_stride,
+                                    W, h));
+        expect(0 == memcmp(got, want, dst_stride * (size_t)h));
+    }
+
+    skcms_CompiledTransform* xform = skcms_TransformCreate(
+            skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &profile,
+            skcms_PixelFormat_RGB_888,   skcms_AlphaFormat_Unpremul, NULL);
+    expect(xform);
+
+    memset(got, 0xab, dst_stride * H);
+    ReverseRunner runner = {0, 0};
+    expect(skcms_TransformRunImageWithRunner(xform, src, src_stride, got, dst_stride, W, H,
+                                             run_tasks_in_reverse, &runner));
+    expect(0 == memcmp(got, want, dst_stride * H));
+    expect(runner.calls == 1 && runner.tasks > 1);
+
+    // Strides must cover at least a whole row, and in-place rows must line up.
+    expect(!skcms_TransformRunImage(xform, src, 4*W-1, got, dst_stride, W, H));
+    expect(!skcms_TransformRunImage(xform, src, src_stride, src, src_stride, W, H));
+    expect( skcms_TransformRunImage(xform, src, src_stride, got, dst_stride, 0, H));
+    skcms_TransformDestroy(xform);
+
+    // Converting RGBA to BGRA in place, with padding.
+    uint8_t px[2][12] = {
+        { 1, 2, 3, 4,  5, 6, 7, 8, 9,9,9,9},
+        {10,11,12,13, 14,15,16,17, 9,9,9,9},
+    };
+    expect(skcms_TransformImage(px, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                NULL, 12,
+                                px, skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul,
+                                NULL, 12,
+                                2, 2));
+    const uint8_t expected[2][12] = {
+        { 3, 2, 1, 4,  7, 6, 5, 8, 9,9,9,9},
+        {12,11,10,13, 16,15,14,17, 9,9,9,9},
+    };
+    expect(0 == memcmp(px, expected, sizeof(px)));
+
+    free(src);
+    free(want);
+    free(got);
+    free(ptr);
+}
+
+// Copy n interleaved pixels of `channels` samples of `bytes` each into separate planes.
+static void split_planes(const uint8_t* interleaved, int n, int channels, int bytes,
+                         uint8_t* planes[4]) {
+    for (int i = 0; i < n; i++)
+    for (int c = 0; c < channels; c++) {
+        memcpy(planes[c] + i*bytes, interleaved + (i*channels + c)*bytes, (size_t)bytes);
+    }
+}
+
+static void test_Planar(void) {
+    void*  ptr;
+    size_t len;
+    expect(load_file("profiles/misc/MartiMaria_browsertest_A2B.icc", &ptr, &len));
+    skcms_ICCProfile profile;
+    expect(skcms_Parse(ptr, len, &profile));
+
+    const struct {
+        skcms_PixelFormat planar, interleaved;
+        int channels, bytes;
+    } formats[] = {
+        { skcms_PixelFormat_RGB_888_Planar,         skcms_PixelFormat_RGB_888,         3, 1 },
+        { skcms_PixelFormat_RGBA_8888_Planar,       skcms_PixelFormat_RGBA_8888,       4, 1 },
+        { skcms_PixelFormat_RGB_161616LE_Planar,    skcms_PixelFormat_RGB_161616LE,    3, 2 },
+        { skcms_PixelFormat_RGBA_16161616LE_Planar, skcms_PixelFormat_RGBA_16161616LE, 4, 2 },
+        { skcms_PixelFormat_RGB_hhh_Planar,         skcms_PixelFormat_RGB_hhh,         3, 2 },
+        { skcms_PixelFormat_RGBA_hhhh_Planar,       skcms_PixelFormat_RGBA_hhhh,       4, 2 },
+        { skcms_PixelFormat_RGB_fff_Planar,         skcms_PixelFormat_RGB_fff,         3, 4 },
+        { skcms_PixelFormat_RGBA_ffff_Planar,       skcms_PixelFormat_RGBA_ffff,       4, 4 },
+    };
+
+    // 37 pixels exercises both full runs of pixels and a tail on every backend.
+    const int n = 37;
+    const uint8_t* rgba = skcms_252_random_bytes;
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+
+    for (int f = 0; f < ARRAY_COUNT(formats); f++)
+    for (int bgr = 0; bgr < 2; bgr++) {
+        const skcms_PixelFormat planar      = (skcms_PixelFormat)(formats[f].planar      + bgr),
+                                interleaved = (skcms_PixelFormat)(formats[f].interleaved + bgr);
+        const int channels = formats[f].channels,
+                  bytes    = formats[f].bytes;
+
+        // Make some interesting pixels in this format, and split them into planes.
+        uint32_t src[37*4], want[37*4], got[37*4];  // Aligned and big enough for RGBA_ffff.
+        expect(skcms_Transform(rgba, skcms_PixelFormat_RGBA_8888, upm, NULL,
+                               src,  interleaved,                 upm, NULL, n));
+        uint32_t plane_storage[2][4][37];
+        skcms_PlanarBuffer src_planes, dst_planes;
+        memset(&src_planes, 0, sizeof(src_planes));
+        memset(&dst_planes, 0, sizeof(dst_planes));
+        uint8_t* planes[4];
+        for (int c = 0; c < 4; c++) {
+            src_planes.planes[c] = planes[c] = (uint8_t*)plane_storage[0][c];
+            dst_planes.planes[c] = plane_storage[1][c];
+        }
+        split_planes((const uint8_t*)src, n, channels, bytes, planes);
+
+        // Planar to interleaved should match interleaved to interleaved.
+        expect(skcms_Transform(src,  interleaved,                 upm, &profile,
+                               want, skcms_PixelFormat_RGBA_8888, upm, NULL, n));
+        expect(skcms_Transform(&src_planes, planar,               upm, &profile,
+                               got,  skcms_PixelFormat_RGBA_8888, upm, NULL, n));
+        expect(0 == memcmp(got, want, (size_t)n*4));
+
+        // Interleaved to planar, likewise.
+        expect(skcms_Transform(rgba, skcms_PixelFormat_RGBA_8888, upm, &profile,
+                               want, interleaved,                 upm, NULL, n));
+        memset(plane_storage[1], 0, sizeof(plane_storage[1]));
+        expect(skcms_Transform(rgba,        skcms_PixelFormat_RGBA_8888, upm, &profile,
+                               &dst_planes, planar,                      upm, NULL, n));
+        uint8_t* want_planes[4];
+        for (int c = 0; c < 4; c++) {
+            want_planes[c] = (uint8_t*)plane_storage[0][c];
+        }
+        split_planes((const uint8_t*)want, n, channels, bytes, want_planes);
+        for (int c = 0; c < channels; c++) {
+            expect(0 == memcmp(dst_planes.planes[c], want_planes[c], (size_t)(n*bytes)));
+        }
+
+        // Planar to planar, as a 2D image of 3 rows of 9 pixels, each row padded to 10 pixels.
+        // The destination sets its strides per plane rather than passing one stride for all.
+        uint32_t image[4][30];
+        skcms_PlanarBuffer image_planes;
+        for (int c = 0; c < 4; c++) {
+            image_planes.planes [c] = image[c];
+            image_planes.strides[c] = (size_t)(10*bytes);
+        }
+        expect(skcms_TransformImage(&dst_planes,   planar, upm, NULL, (size_t)(10*bytes),
+                                    &image_planes, planar, upm, NULL, 0,
+                                    9, 3));
+        for (int c = 0; c < channels; c++)
+        for (int y = 0; y < 3; y++) {
+            expect(0 == memcmp((const uint8_t*)image[c]            + 10*bytes*y,
+                               (const uint8_t*)dst_planes.planes[c] + 10*bytes*y,
+                               (size_t)(9*bytes)));
+        }
+
+        // Planar and interleaved buffers can't be the same pointer.
+        expect(!skcms_Transform(&src_planes, planar,      upm, NULL,
+                                &src_planes, interleaved, upm, NULL, 1));
+    }
+
+    free(ptr);
+}
+
+static void test_YCbCr(void) {
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+
+    // Transforming to the same profile leaves just the YCbCr to R'G'B' matrix to check.
+    skcms_ICCProfile profile = *skcms_sRGB_profile();
+    profile.has_CICP = true;
+    profile.CICP.color_primaries          = 1;
+    profile.CICP.transfer_characteristics = 13;
+
+    uint8_t y[] = {100, 16, 235}, cb[] = {128, 128, 128}, cr[] = {200, 128, 128};
+    skcms_PlanarBuffer planes;
+    memset(&planes, 0, sizeof(planes));
+    planes.planes[0] = y;
+    planes.planes[1] = cb;
+    planes.planes[2] = cr;
+
+    // Full range BT.601: R = Y + 1.402(Cr-128), G = Y - 0.714(Cr-128), B = Y.
+    profile.CICP.matrix_coefficients   = 6;
+    profile.CICP.video_full_range_flag = 1;
+    uint8_t rgb[9];
+    expect(skcms_Transform(&planes, skcms_PixelFormat_YCbCr_444_888, upm, &profile,
+                           rgb,     skcms_PixelFormat_RGB_888,       upm, &profile, 3));
+    expect(rgb[0] == 201 && rgb[1] ==  49 && rgb[2] == 100);
+    expect(rgb[3] ==  16 && rgb[4] ==  16 && rgb[5] ==  16);
+    expect(rgb[6] == 235 && rgb[7] == 235 && rgb[8] == 235);
+
+    // Limited range expands [16,235] to [0,255].
+    profile.CICP.video_full_range_flag = 0;
+    expect(skcms_Transform(&planes, skcms_PixelFormat_YCbCr_444_888, upm, &profile,
+                           rgb,     skcms_PixelFormat_RGB_888,       upm, &profile, 3));
+    expect(rgb[3] ==   0 && rgb[4] ==   0 && rgb[5] ==   0);
+    expect(rgb[6] == 255 && rgb[7] == 255 && rgb[8] == 255);
+
+    // Identity (GBR) just reorders channels.
+    profile.CICP.matrix_coefficients   = 0;
+    profile.CICP.video_full_range_flag = 1;
+    expect(skcms_Transform(&planes, skcms_PixelFormat_YCbCr_444_888, upm, &profile,
+                           rgb,     skcms_PixelFormat_RGB_888,       upm, &profile, 3));
+    expect(rgb[0] == 200 && rgb[1] == 100 && rgb[2] == 128);
+
+    // Matrix coefficients we don't know, and non-RGB profiles, aren't supported.
+    profile.CICP.matrix_coefficients = 4;
+    expect(!skcms_Transform(&planes, skcms_PixelFormat_YCbCr_444_888, upm, &profile,
+                            rgb,     skcms_PixelFormat_RGB_888,       upm, &profile, 3));
+
+    // Subsampled formats should match 4:4:4 with each chroma sample replicated, here for a
+    // 37x3 image with odd dimensions, full runs of pixels, and a tail on every backend.
+    enum { W = 37, H = 3, CW = (W+1)/2, CH = (H+1)/2 };
+    const uint8_t* random = skcms_252_random_bytes;
+    uint8_t Y[W*H], U[CW*H], V[CW*H];
+    memcpy(Y, random,            sizeof(Y));
+    memcpy(U, random + W*H,      sizeof(U));
+    memcpy(V, random + W*H + 80, sizeof(V));
+
+    uint8_t  U444[W*H], V444[W*H], UV[CW*CH*2];
+    uint16_t Y16[W*H], U16_444[W*H], V16_444[W*H], UV16[CW*CH*2];
+    for (int i = 0; i < W*H; i++) {
+        Y16[i] = (uint16_t)(Y[i] << 8);
+    }
+    for (int j = 0; j < CW*CH; j++) {
+        UV  [2*j+0] = U[j];                    UV  [2*j+1] = V[j];
+        UV16[2*j+0] = (uint16_t)(U[j] << 8);  UV16[2*j+1] = (uint16_t)(V[j] << 8);
+    }
+
+    for (int vshift = 0; vshift < 2; vshift++) {
+        for (int row = 0; row < H; row++)
+        for (int col = 0; col < W; col++) {
+            const int c = (row >> vshift) * CW + (col >> 1);
+            U444   [row*W + col] = U[c];
+            V444   [row*W + col] = V[c];
+            U16_444[row*W + col] = (uint16_t)(U[c] << 8);
+            V16_444[row*W + col] = (uint16_t)(V[c] << 8);
+        }
+
+        uint32_t want[W*H], got[W*H];
+        planes.planes[0] = Y;
+        planes.planes[1] = U444;
+        planes.planes[2] = V444;
+        expect(skcms_TransformImage(&planes, skcms_PixelFormat_YCbCr_444_888, upm, NULL, W,
+                                    want,    skcms_PixelFormat_RGBA_8888,     upm, NULL, 4*W,
+                                    W, H));
+
+        // I422 or I420, with chroma planes narrower than the luma plane.
+        planes.planes[1] = U;
+        planes.planes[2] = V;
+        planes.strides[1] = planes.strides[2] = CW;
+        expect(skcms_TransformImage(&planes, vshift ? skcms_PixelFormat_YCbCr_420_888
+                                                    : skcms_PixelFormat_YCbCr_422_888,
+                                    upm, NULL, W,
+                                    got, skcms_PixelFormat_RGBA_8888, upm, NULL, 4*W,
+                                    W, H));
+        expect(0 == memcmp(got, want, sizeof(want)));
+
+        // YV12 is I420 with the chroma planes swapped.
+        if (vshift) {
+            planes.planes[1] = V;
+            planes.planes[2] = U;
+            memset(got, 0, sizeof(got));
+            expect(skcms_TransformImage(&planes, skcms_PixelFormat_YCrCb_420_888, upm, NULL, W,
+                                        got,     skcms_PixelFormat_RGBA_8888,     upm, NULL, 4*W,
+                                        W, H));
+            expect(0 == memcmp(got, want, sizeof(want)));
+
+            // NV12 interleaves the chroma planes.
+            planes.planes [1] = UV;
+            planes.strides[1] = 2*CW;
+            memset(got, 0, sizeof(got));
+            expect(skcms_TransformImage(&planes, skcms_PixelFormat_YCbCr_420_88, upm, NULL, W,
+                                        got,     skcms_PixelFormat_RGBA_8888,    upm, NULL, 4*W,
+                                        W, H));
+            expect(0 == memcmp(got, want, sizeof(want)));
+
+            // P016 is NV12 with 16-bit samples, which should match 16-bit 4:4:4 exactly.
+            planes.planes [0] = Y16;
+            planes.planes [1] = U16_444;
+            planes.planes [2] = V16_444;
+            planes.strides[1] = planes.strides[2] = 0;
+            expect(skcms_TransformImage(&planes, skcms_PixelFormat_YCbCr_444_161616,
+                                        upm, NULL, 2*W,
+                                        want, skcms_PixelFormat_RGBA_8888, upm, NULL, 4*W,
+                                        W, H));
+            planes.planes [1] = UV16;
+            planes.strides[1] = 4*CW;
+            memset(got, 0, sizeof(got));
+            expect(skcms_TransformImage(&planes, skcms_PixelFormat_YCbCr_420_1616,
+                                        upm, NULL, 2*W,
+                                        got, skcms_PixelFormat_RGBA_8888, upm, NULL, 4*W,
+                                        W, H));
+            expect(0 == memcmp(got, want, sizeof(want)));
+        }
+        planes.strides[1] = planes.strides[2] = 0;
+    }
+
+    // Chroma planes too narrow for the image are rejected.
+    uint32_t px[W*H];
+    planes.planes[0] = Y;
+    planes.planes[1] = U;
+    planes.planes[2] = V;
+    planes.strides[1] = planes.strides[2] = CW-1;
+    expect(!skcms_TransformImage(&planes, skcms_PixelFormat_YCbCr_420_888, upm, NULL, W,
+                                 px,      skcms_PixelFormat_RGBA_8888,     upm, NULL, 4*W,
+                                 W, H));
+}
+
+static void test_BakedLUT(void) {
+    void*  ptr;
+    size_t len;
+    expect(load_file("profiles/color.org/Upper_Left.icc", &ptr, &len));
+    skcms_ICCProfile profile;
+    expect(skcms_Parse(ptr, len, &profile));
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    const uint8_t* src = skcms_252_random_bytes;
+    const int n = 252/4;
+
+    // An A2B source should bake with little error, and each byte should land within that error.
+    float max_error = -1;
+    skcms_CompiledTransform* exact = skcms_TransformCreate(
+            skcms_PixelFormat_RGBA_8888, upm, &profile,
+            skcms_PixelFormat_BGRA_8888, upm, NULL);
+    skcms_CompiledTransform* baked = skcms_TransformCreateBaked(
+            skcms_PixelFormat_RGBA_8888, upm, &profile,
+            skcms_PixelFormat_BGRA_8888, upm, NULL, 33, &max_error);
+    expect(exact && baked);
+    expect(0 <= max_error && max_error < 1);
+
+    uint8_t want[252], got[252];
+    expect(skcms_TransformRun(exact, src, want, n));
+    expect(skcms_TransformRun(baked, src, got , n));
+    for (int i = 0; i < 4*n; i++) {
+        expect(abs(got[i] - want[i]) <= (int)max_error + 1);
+        if (i % 4 == 3) {
+            expect(got[i] == src[i]);  // Alpha passes through untouched.
+        }
+    }
+    skcms_TransformDestroy(exact);
+    skcms_TransformDestroy(baked);
+
+    // Even the smallest grid reproduces an identity transform exactly.
+    baked = skcms_TransformCreateBaked(skcms_PixelFormat_BGRA_8888, upm, NULL,
+                                       skcms_PixelFormat_RGB_888,   upm, NULL, 2, &max_error);
+    expect(baked);
+    expect(max_error < 0.01f);
+    expect(skcms_TransformRun(baked, src, got, n));
+    for (int i = 0; i < n; i++) {
+        expect(got[3*i+0] == src[4*i+2]);
+        expect(got[3*i+1] == src[4*i+1]);
+        expect(got[3*i+2] == src[4*i+0]);
+    }
+    skcms_TransformDestroy(baked);
+
+    // Only 8-bit RGB(A) formats and reasonable grid sizes can be baked.
+    expect(!skcms_TransformCreateBaked(skcms_PixelFormat_RGBA_8888, upm, NULL,
+                                       skcms_PixelFormat_RGBA_8888, upm, NULL, 1, NULL));
+    expect(!skcms_TransformCreateBaked(skcms_PixelFormat_RGBA_8888, upm, NULL,
+                                       skcms_PixelFormat_RGBA_8888, upm, NULL, 66, NULL));
+    expect(!skcms_TransformCreateBaked(skcms_PixelFormat_RGBA_16161616LE, upm, NULL,
+                                       skcms_PixelFormat_RGBA_8888,       upm, NULL, 17, NULL));
+
+    free(ptr);
+}
+
+// SKCMS_PROFILE builds skip fast paths so they can time every op, and only they count ops run.
+static bool profiling(void) {
+    uint8_t px[4] = {0};
+    skcms_ResetStageProfile();
+    expect(skcms_Transform(px, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL,
+                           px, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL, 1));
+    skcms_StageProfile stage;
+    const bool profiling = skcms_GetStageProfile(&stage, 1) > 0;
+    skcms_ResetStageProfile();
+    return profiling;
+}
+
+static const char* transform_path(const skcms_CompiledTransform* xform) {
+    skcms_TransformDescription desc;
+    skcms_DescribeTransform(xform, &desc);
+    return desc.path;
+}
+
+static void test_ByteLUTs(void) {
+    // Retagging sRGB pixels as gamma 2.2 (same gamut) needs no channel mixing, so large enough
+    // transforms between 8-bit formats run as per-channel lookups.  They should match exactly.
+    skcms_ICCProfile gamma22 = *skcms_sRGB_profile();
+    skcms_TransferFunction tf = { 2.2f, 1, 0, 0, 0, 0, 0 };
+    skcms_SetTransferFunction(&gamma22, &tf);
+
+    const skcms_PixelFormat fmts[] = {
+        skcms_PixelFormat_RGBA_8888,
+        skcms_PixelFormat_BGR_888,
+        skcms_PixelFormat_RGBA_8888_sRGB,
+    };
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+
+    enum { kPixels = 4096 };
+    static uint8_t src[kPixels*4], want[kPixels*4], got[kPixels*4];
+    for (int i = 0; i < kPixels*4; i++) {
+        src[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+
+    for (int s = 0; s < ARRAY_COUNT(fmts); s++)
+    for (int d = 0; d < ARRAY_COUNT(fmts); d++)
+    for (int opaque = 0; opaque < 2; opaque++) {
+        const skcms_AlphaFormat alpha = opaque ? skcms_AlphaFormat_Opaque : upm;
+
+        const int src_bpp = fmts[s] == skcms_PixelFormat_BGR_888 ? 3 : 4,
+                  dst_bpp = fmts[d] == skcms_PixelFormat_BGR_888 ? 3 : 4;
+        const size_t bytes = (size_t)(kPixels * dst_bpp);
+
+        // Small calls always run the program.
+        for (int i = 0; i < kPixels; i += 64) {
+            expect(skcms_Transform(src  + i*src_bpp, fmts[s], alpha, NULL,
+                                   want + i*dst_bpp, fmts[d], alpha, &gamma22, 64));
+        }
+
+        memset(got, 0, sizeof(got));
+        expect(skcms_Transform(src, fmts[s], alpha, NULL,
+                               got, fmts[d], alpha, &gamma22, kPixels));
+        expect(0 == memcmp(got, want, bytes));
+
+        memset(got, 0, sizeof(got));
+        skcms_CompiledTransform* xform = skcms_TransformCreate(fmts[s], alpha, NULL,
+                                                               fmts[d], alpha, &gamma22);
+        expect(xform);
+        expect(profiling() || 0 == strcmp(transform_path(xform), "byte LUTs"));
+        expect(skcms_TransformRun(xform, src, got, kPixels));
+        expect(0 == memcmp(got, want, bytes));
+
+        // A count that's not a multiple of any vector size leaves a tail.
+        memset(got, 0, sizeof(got));
+        expect(skcms_TransformRun(xform, src, got, kPixels-5));
+        expect(0 == memcmp(got, want, bytes - (size_t)(5*dst_bpp)));
+        skcms_TransformDestroy(xform);
+
+        // In place, too.
+        if (fmts[s] == fmts[d]) {
+            memcpy(got, src, sizeof(got));
+            expect(skcms_Transform(got, fmts[s], alpha, NULL,
+                                   got, fmts[d], alpha, &gamma22, kPixels));
+            expect(0 == memcmp(got, want, bytes));
+        }
+    }
+
+    // Without any curves, the program is just as exact and faster than lookups.
+    skcms_CompiledTransform* swizzle = skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, NULL,
+                                                             skcms_PixelFormat_BGRA_8888, upm, NULL);
+    expect(swizzle);
+    expect(0 != strcmp(transform_path(swizzle), "byte LUTs"));
+    skcms_TransformDestroy(swizzle);
+}
+
+static void test_Lowp(void) {
+    // Gamut conversions between 8-bit formats run in 16-bit fixed point when created with
+    // skcms_TransformCreateLowp(), and should land within a code value or two of the float
+    // program.  Every other way to run them matches skcms_Transform() exactly.
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile adobe;
+    expect(load_file("profiles/misc/AdobeRGB.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &adobe));
+
+    const skcms_ICCProfile* profiles[][2] = {
+        { skcms_sRGB_profile(), &adobe },
+        { &adobe, skcms_sRGB_profile() },
+    };
+    const skcms_PixelFormat fmts[] = {
+        skcms_PixelFormat_RGBA_8888,
+        skcms_PixelFormat_BGR_888,
+        skcms_PixelFormat_BGRA_8888,
+    };
+    const skcms_AlphaFormat alphas[] = {
+        skcms_AlphaFormat_Unpremul,
+        skcms_AlphaFormat_Opaque,
+        skcms_AlphaFormat_PremulAsEncoded,
+    };
+
+    enum { kPixels = 4099 };
+    static uint8_t upm[kPixels*4], pm[kPixels*4], want[kPixels*4], got[kPixels*4];
+    for (int i = 0; i < kPixels*4; i++) {
+        upm[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+    // Premultiplied pixels (as 4-byte formats) should have no color channel above alpha.
+    for (int i = 0; i < kPixels*4; i++) {
+        const uint8_t a = upm[i | 3];
+        pm[i] = upm[i] < a ? upm[i] : a;
+    }
+
+    for (int p = 0; p < ARRAY_COUNT(profiles); p++)
+    for (int s = 0; s < ARRAY_COUNT(fmts);     s++)
+    for (int d = 0; d < ARRAY_COUNT(fmts);     d++)
+    for (int a = 0; a < ARRAY_COUNT(alphas);   a++) {
+        const int dst_bpp = fmts[d] == skcms_PixelFormat_BGR_888 ? 3 : 4;
+        const uint8_t* src = alphas[a] == skcms_AlphaFormat_PremulAsEncoded ? pm : upm;
+
+        expect(skcms_Transform(src,  fmts[s], alphas[a], profiles[p][0],
+                               want, fmts[d], alphas[a], profiles[p][1], kPixels));
+
+        skcms_CompiledTransform* xform = skcms_TransformCreate(fmts[s], alphas[a], profiles[p][0],
+                                                               fmts[d], alphas[a], profiles[p][1]);
+        expect(xform);
+        expect(0 != strcmp(transform_path(xform), "lowp"));
+        memset(got, 0, sizeof(got));
+        expect(skcms_TransformRun(xform, src, got, kPixels));
+        skcms_TransformDestroy(xform);
+        expect(0 == memcmp(got, want, (size_t)(kPixels*dst_bpp)));
+
+        xform = skcms_TransformCreateLowp(fmts[s], alphas[a], profiles[p][0],
+                                          fmts[d], alphas[a], profiles[p][1]);
+        expect(xform);
+        if (!profiling() && skcms_TransformGetBackend(xform) != skcms_Backend_SKX) {
+            expect(0 == strcmp(transform_path(xform), "lowp"));
+        }
+        memset(got, 0, sizeof(got));
+        expect(skcms_TransformRun(xform, src, got, kPixels));
+        skcms_TransformDestroy(xform);
+
+        for (int i = 0; i < kPixels*dst_bpp; i++) {
+            expect(abs(got[i] - want[i]) <= 2);
+        }
+    }
+    free(ptr);
+}
+
+static void test_SmallTables(void) {
+    // Curves with few enough table entries get decoded into table_small_* ops: up to 16 entries
+    // with any backend, and up to 32 with AVX-512.  They should match table lookups exactly.
+    const int sizes[] = { 2, 13, 29 };
+    const skcms_Backend backends[] = {
+        skcms_Backend_Baseline,
+        skcms_Backend_SSE41,
+        skcms_Backend_HSW,
+        skcms_Backend_SKX,
+    };
+
+    enum { kN = 257 };
+    float src[kN*4], dst[kN*4];
+    for (int i = 0; i < kN*4; i++) {
+        src[i] = (float)(i % kN) * (1.25f / (kN-1)) - 0.125f;
+    }
+
+    skcms_ICCProfile linear = *skcms_sRGB_profile();
+    skcms_SetTransferFunction(&linear, skcms_Identity_TransferFunction());
+
+    for (int s = 0; s < ARRAY_COUNT(sizes); s++) {
+        const int n = sizes[s];
+        uint8_t table_16[2*32];
+        for (int k = 0; k < n; k++) {
+            const int v = (k * k * 65535) / ((n-1) * (n-1));
+            table_16[2*k+0] = (uint8_t)(v >> 8);
+            table_16[2*k+1] = (uint8_t)(v >> 0);
+        }
+
+        skcms_ICCProfile profile = *skcms_sRGB_profile();
+        for (int c = 0; c < 3; c++) {
+            profile.trc[c].table_entries = (uint32_t)n;
+            profile.trc[c].table_8       = NULL;
+            profile.trc[c].table_16      = table_16;
+        }
+
+        for (int b = 0; b < ARRAY_COUNT(backends); b++) {
+            const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+            skcms_CompiledTransform* xform = skcms_TransformCreateWithBackend(
+                    skcms_PixelFormat_RGBA_ffff, upm, &profile,
+                    skcms_PixelFormat_RGBA_ffff, upm, &linear, backends[b]);
+            if (!xform) {
+                continue;
+            }
+            skcms_TransformDescription desc;
+            skcms_DescribeTransform(xform, &desc);
+            const bool small = n <= 16 || backends[b] == skcms_Backend_SKX;
+            expect(desc.op_count == 5);
+            expect(0 == strcmp(desc.ops[1], small ? "table_small_b" : "table_b"));
+
+            expect(skcms_TransformRun(xform, src, dst, kN));
+            skcms_TransformDestroy(xform);
+
+            for (int i = 0; i < kN*4; i++) {
+                if (i % 4 == 3) {
+                    expect(dst[i] == src[i]);
+                    continue;
+                }
+                float x  = src[i] < 0 ? 0 : src[i] > 1 ? 1 : src[i],
+                      ix = x * (float)(n-1);
+                int   lo = (int)ix,
+                      hi = lo + 1 < n ? lo + 1 : lo;
+                float l  = (float)(table_16[2*lo] << 8 | table_16[2*lo+1]) * (1/65535.0f),
+                      h  = (float)(table_16[2*hi] << 8 | table_16[2*hi+1]) * (1/65535.0f);
+                expect(fabsf_(dst[i] - (l + (h-l)*(ix - (float)lo))) < 1e-6f);
+            }
+        }
+    }
+}
+
+static void test_DecodedTables(void) {
+    // Compiled transforms decode their curve tables to floats up front.  They should match
+    // small skcms_Transform() calls, which read the tables as they go, exactly.
+    const char* filenames[] = {
+        "profiles/mobile/sRGB_LUT.icc",
+        "profiles/misc/Kodak_sRGB.icc",
+        "profiles/misc/Coated_FOGRA39_CMYK.icc",
+    };
+    const skcms_Backend backends[] = {
+        skcms_Backend_Baseline,
+        skcms_Backend_SSE41,
+        skcms_Backend_HSW,
+        skcms_Backend_SKX,
+    };
+
+    enum { kN = 1024 };
+    static uint8_t src[kN*4];
+    static float   want[kN*4], got[kN*4];
+    for (int i = 0; i < kN*4; i++) {
+        src[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+
+    for (int f = 0; f < ARRAY_COUNT(filenames); f++) {
+        void*  ptr;
+        size_t len;
+        skcms_ICCProfile profile;
+        expect(load_file(filenames[f], &ptr, &len));
+        expect(skcms_Parse(ptr, len, &profile));
+
+        for (int b = 0; b < ARRAY_COUNT(backends); b++) {
+            if (!skcms_SetBackend(backends[b])) {
+                continue;
+            }
+            const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+            expect(skcms_Transform(src,  skcms_PixelFormat_RGBA_8888, upm, &profile,
+                                   want, skcms_PixelFormat_RGBA_ffff, upm, skcms_sRGB_profile(),
+                                   kN));
+
+            skcms_CompiledTransform* xform =
+                skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, &profile,
+                                      skcms_PixelFormat_RGBA_ffff, upm, skcms_sRGB_profile());
+            expect(xform);
+
+            skcms_TransformDescription desc;
+            skcms_DescribeTransform(xform, &desc);
+            bool saw_decoded = false;
+            for (int i = 0; i < desc.op_count; i++) {
+                saw_decoded |= 0 == strncmp(desc.ops[i], "table_", 6)
+                            && NULL != strstr(desc.contexts[i], "decoded");
+            }
+            expect(saw_decoded);
+
+            expect(skcms_TransformRun(xform, src, got, kN));
+            skcms_TransformDestroy(xform);
+            expect(0 == memcmp(got, want, sizeof(got)));
+        }
+        free(ptr);
+    }
+    expect(skcms_SetBackend(skcms_Backend_Auto));
+}
+
+static void test_CLUTLayout(void) {
+    // Packed and blocked CLUTs hold the same samples as the ICC grids, so they should give
+    // identical results, whether the CLUT is used for the source (A2B) or the destination (B2A).
+    // (Upper_Left's A2B has no CLUT at all, so there's nothing to pack there.)
+    const char* filenames[] = {
+        "profiles/misc/MartiMaria_browsertest_A2B.icc",
+        "profiles/misc/Coated_FOGRA39_CMYK.icc",
+        "profiles/misc/US_Web_Coated_SWOP_CMYK.icc",
+        "profiles/misc/XRite_GRACol7_340_CMYK.icc",
+        "profiles/color.org/Upper_Left.icc",
+    };
+    const skcms_Backend backends[] = {
+        skcms_Backend_Baseline,
+        skcms_Backend_SSE41,
+        skcms_Backend_HSW,
+        skcms_Backend_SKX,
+    };
+
+    enum { kN = 1024 };
+    static uint8_t src[kN*4];
+    static float   want[kN*4], got[kN*4];
+    for (int i = 0; i < kN*4; i++) {
+        src[i] = skcms_252_random_bytes[i % 252] ^ (uint8_t)(i / 252);
+    }
+
+    for (int f = 0; f < ARRAY_COUNT(filenames); f++) {
+        void*  ptr;
+        size_t len;
+        skcms_ICCProfile profile;
+        expect(load_file(filenames[f], &ptr, &len));
+        expect(skcms_Parse(ptr, len, &profile));
+
+        for (int b = 0; b < ARRAY_COUNT(backends); b++) {
+            if (!skcms_SetBackend(backends[b])) {
+                continue;
+            }
+            for (int as_dst = 0; as_dst < 2; as_dst++) {
+                const skcms_ICCProfile* srcProfile = as_dst ? skcms_sRGB_profile() : &profile;
+                const skcms_ICCProfile* dstProfile = as_dst ? &profile : skcms_sRGB_profile();
+                if (as_dst && !profile.has_B2A) {
+                    continue;
+                }
+
+                const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+                skcms_CompiledTransform* icc =
+                    skcms_TransformCreateWithCLUTLayout(
+                            skcms_PixelFormat_RGBA_8888, upm, srcProfile,
+                            skcms_PixelFormat_RGBA_ffff, upm, dstProfile, skcms_CLUTLayout_ICC);
+                expect(icc);
+                expect(skcms_TransformRun(icc, src, want, kN));
+                skcms_TransformDestroy(icc);
+
+                const struct { skcms_CLUTLayout layout; const char* desc; } layouts[] = {
+                    { skcms_CLUTLayout_Packed,  ", packed"          },
+                    { skcms_CLUTLayout_Blocked, ", packed, blocked" },
+                };
+                for (int l = 0; l < ARRAY_COUNT(layouts); l++) {
+                    skcms_CompiledTransform* xform =
+                        skcms_TransformCreateWithCLUTLayout(
+                                skcms_PixelFormat_RGBA_8888, upm, srcProfile,
+                                skcms_PixelFormat_RGBA_ffff, upm, dstProfile, layouts[l].layout);
+                    expect(xform);
+
+                    skcms_TransformDescription desc;
+                    skcms_DescribeTransform(xform, &desc);
+                    bool saw_layout = false;
+                    for (int i = 0; i < desc.op_count; i++) {
+                        const char* found = strstr(desc.contexts[i], ", packed");
+                        saw_layout |= 0 == strncmp(desc.ops[i], "clut_", 5)
+                                   && found && 0 == strcmp(found, layouts[l].desc);
+                    }
+                    const bool has_clut = as_dst ? profile.B2A.input_channels > 0
+                                                 : profile.A2B.input_channels > 0;
+                    expect(saw_layout == has_clut);
+
+                    expect(skcms_TransformRun(xform, src, got, kN));
+                    skcms_TransformDestroy(xform);
+                    expect(0 == memcmp(got, want, sizeof(got)));
+                }
+            }
+        }
+        free(ptr);
+    }
+    expect(skcms_SetBackend(skcms_Backend_Auto));
+}
+
+typedef struct {
+    int calls, before, after;
+} OptimizerCounts;
+
+static void count_optimizer_ops(void* ctx, int before, int after) {
+    OptimizerCounts* counts = (OptimizerCounts*)ctx;
+    counts->calls++;
+    counts->before = before;
+    counts->after  = after;
+}
+
+static void test_Optimizer(void) {
+    OptimizerCounts counts = {0,0,0};
+    skcms_SetOptimizerHook(count_optimizer_ops, &counts);
+
+    // With linear profiles, the sRGB curve RGBA_8888_sRGB decodes with is immediately re-encoded,
+    // leaving nothing between the load and the store.
+    skcms_ICCProfile linear = *skcms_sRGB_profile();
+    skcms_SetTransferFunction(&linear, skcms_Identity_TransferFunction());
+    skcms_ICCProfile linear_copy = linear;
+
+    uint8_t src[256*4], dst[256*4];
+    for (int i = 0; i < 256*4; i++) {
+        src[i] = (uint8_t)(i * 7);
+    }
+    expect(skcms_Transform(src, skcms_PixelFormat_RGBA_8888_sRGB, skcms_AlphaFormat_Unpremul,
+                           &linear,
+                           dst, skcms_PixelFormat_RGBA_8888_sRGB, skcms_AlphaFormat_Unpremul,
+                           &linear_copy, 256));
+    expect(counts.calls == 1);
+    expect(counts.before > counts.after);
+    expect(counts.after == 2);
+    expect(0 == memcmp(src, dst, sizeof(src)));
+
+    // BGRA to BGRA swaps r and b after loading and before storing.  Both swaps fold into the
+    // gamut matrix, so results should match RGBA to RGBA.
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile adobe;
+    expect(load_file("profiles/misc/AdobeRGB.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &adobe));
+
+    uint8_t bgra[256*4], want[256*4];
+    for (int i = 0; i < 256; i++) {
+        bgra[4*i+0] = src[4*i+2];
+        bgra[4*i+1] = src[4*i+1];
+        bgra[4*i+2] = src[4*i+0];
+        bgra[4*i+3] = src[4*i+3];
+    }
+    expect(skcms_Transform(src,  skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL,
+                           want, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &adobe,
+                           256));
+    const int rgba_ops = counts.after;
+
+    counts.calls = 0;
+    expect(skcms_Transform(bgra, skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul, NULL,
+                           dst,  skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul, &adobe,
+                           256));
+    expect(counts.calls == 1);
+    expect(counts.before == rgba_ops + 2);
+    expect(counts.after  == rgba_ops);
+    for (int i = 0; i < 256; i++) {
+        expect(abs(dst[4*i+0] - want[4*i+2]) <= 1);
+        expect(abs(dst[4*i+1] - want[4*i+1]) <= 1);
+        expect(abs(dst[4*i+2] - want[4*i+0]) <= 1);
+        expect(abs(dst[4*i+3] - want[4*i+3]) <= 1);
+    }
+
+    // Opaque to opaque forces alpha to 1 after loading and again before storing.  Nothing in
+    // between touches alpha, so only the first should be left.
+    counts.calls = 0;
+    expect(skcms_Transform(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Opaque, NULL,
+                           dst, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Opaque, &adobe,
+                           256));
+    expect(counts.calls == 1);
+    expect(counts.before == rgba_ops + 2);
+    expect(counts.after  == rgba_ops + 1);
+    for (int i = 0; i < 256; i++) {
+        expect(dst[4*i+3] == 0xff);
+    }
+
+    skcms_SetOptimizerHook(NULL, NULL);
+    counts.calls = 0;
+    expect(skcms_Transform(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, NULL,
+                           dst, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul, &adobe,
+                           256));
+    expect(counts.calls == 0);
+    free(ptr);
+}
+
+// The most common programs run through kernels specialized for them, which must match the
+// interpreter bit for bit.  Planar sources run the same ops through the interpreter.
+static void test_SpecializedKernels(void) {
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile p3;
+    expect(load_file("profiles/mobile/Display_P3_parametric.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &p3));
+
+    skcms_ICCProfile linear = *skcms_sRGB_profile();
+    skcms_SetTransferFunction(&linear, skcms_Identity_TransferFunction());
+
+    // An odd count leaves a tail for every vector width.  Keep the source valid premul.
+    enum { kN = 1001 };
+    uint8_t src[kN*4], planes[4][kN], want[kN*8], got[kN*8];  // Big enough for RGBA_hhhh.
+    for (int i = 0; i < kN; i++) {
+        const uint8_t alpha = (uint8_t)(i * 37);
+        src[4*i+0] = (uint8_t)((i * 7)  % (alpha + 1));
+        src[4*i+1] = (uint8_t)((i * 13) % (alpha + 1));
+        src[4*i+2] = (uint8_t)((i * 29) % (alpha + 1));
+        src[4*i+3] = alpha;
+    }
+    skcms_PlanarBuffer src_planes;
+    memset(&src_planes, 0, sizeof(src_planes));
+    uint8_t* split[4];
+    for (int c = 0; c < 4; c++) {
+        src_planes.planes[c] = split[c] = planes[c];
+    }
+    split_planes(src, kN, 4, 1, split);
+
+    const struct {
+        const skcms_ICCProfile* from;
+        const skcms_ICCProfile* to;
+        skcms_PixelFormat       dstFmt;
+        size_t                  dst_bpp;
+    } cases[] = {
+        // sRGB to Display P3 and back, 8888.
+        { skcms_sRGB_profile(), &p3,                  skcms_PixelFormat_RGBA_8888, 4 },
+        { &p3,                  skcms_sRGB_profile(), skcms_PixelFormat_RGBA_8888, 4 },
+        // sRGB 8888 to linear half float.
+        { skcms_sRGB_profile(), &linear,              skcms_PixelFormat_RGBA_hhhh, 8 },
+    };
+    const skcms_AlphaFormat alphas[] = {
+        skcms_AlphaFormat_Unpremul,
+        skcms_AlphaFormat_Opaque,
+        skcms_AlphaFormat_PremulAsEncoded,
+    };
+    // HSW compiles these programs with the JIT instead.
+    const skcms_Backend backends[] = {
+        skcms_Backend_Baseline,
+        skcms_Backend_SSE41,
+        skcms_Backend_SKX,
+    };
+
+    for (int c = 0; c < ARRAY_COUNT(cases);    c++)
+    for (int k = 0; k < ARRAY_COUNT(alphas);   k++)
+    for (int b = 0; b < ARRAY_COUNT(backends); b++) {
+        if (!skcms_IsBackendAvailable(backends[b])) {
+            continue;
+        }
+        skcms_CompiledTransform* kernel = skcms_TransformCreateWithBackend(
+                skcms_PixelFormat_RGBA_8888, alphas[k], cases[c].from,
+                cases[c].dstFmt,             alphas[k], cases[c].to, backends[b]);
+        skcms_CompiledTransform* interp = skcms_TransformCreateWithBackend(
+                skcms_PixelFormat_RGBA_8888_Planar, alphas[k], cases[c].from,
+                cases[c].dstFmt,                    alphas[k], cases[c].to, backends[b]);
+        expect(kernel && interp);
+        if (!profiling()) {
+            expect(0 == strcmp(transform_path(kernel), "kernel"));
+        }
+        expect(0 == strcmp(transform_path(interp), "interpreter"));
+
+        memset(want, 0, sizeof(want));
+        memset(got,  0, sizeof(got));
+        expect(skcms_TransformRun(interp, &src_planes, want, kN));
+        expect(skcms_TransformRun(kernel,  src,        got,  kN));
+        expect(0 == memcmp(got, want, kN * cases[c].dst_bpp));
+
+        skcms_TransformDestroy(kernel);
+        skcms_TransformDestroy(interp);
+    }
+    free(ptr);
+}
+
+// Whether skcms was built with its JIT, which emits AVX2 code for HSW transforms, and isn't
+// written for Windows or visible to MemorySanitizer.
+static bool jit_available(void) {
+#if defined(SKCMS_DISABLE_JIT) || defined(_WIN32)
+    return false;
+#elif defined(__has_feature)
+    #if __has_feature(memory_sanitizer)
+    return false;
+    #endif
+#endif
+    return skcms_IsBackendAvailable(skcms_Backend_HSW);
+}
+
+// HSW transforms compile float programs to machine code, which must match the interpreter that
+// skcms_Transform() runs on small spans bit for bit.  We ask for HSW even when AVX-512 is
+// available, where skcms would otherwise pick SKX and never run the JIT.
+static void test_Jit(void) {
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile p3;
+    expect(load_file("profiles/mobile/Display_P3_parametric.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &p3));
+
+    // An odd count leaves a tail.  Floats stray a little outside [0,1] but are never NaN.
+    enum { kN = 333 };
+    uint8_t bytes[kN*4];
+    float   floats[kN*4], want[kN*4], got[kN*4];
+    for (int i = 0; i < kN*4; i++) {
+        bytes [i] = (uint8_t)(i * 37);
+        floats[i] = (float)((i * 73) % 1200) * (1/1000.0f) - 0.1f;
+    }
+
+    const struct {
+        const void*             src;
+        skcms_PixelFormat       srcFmt;
+        const skcms_ICCProfile* srcProfile;
+        skcms_PixelFormat       dstFmt;
+        const skcms_ICCProfile* dstProfile;
+    } cases[] = {
+        { bytes,  skcms_PixelFormat_RGBA_8888, skcms_sRGB_profile(),
+                  skcms_PixelFormat_RGBA_ffff, &p3 },
+        { bytes,  skcms_PixelFormat_BGRA_8888, &p3,
+                  skcms_PixelFormat_RGBA_ffff, skcms_sRGB_profile() },
+        { floats, skcms_PixelFormat_RGBA_ffff, &p3,
+                  skcms_PixelFormat_RGBA_8888, skcms_sRGB_profile() },
+        { floats, skcms_PixelFormat_RGBA_ffff, skcms_sRGB_profile(),
+                  skcms_PixelFormat_BGRA_8888, &p3 },
+        { floats, skcms_PixelFormat_RGBA_ffff, skcms_sRGB_profile(),
+                  skcms_PixelFormat_RGBA_ffff, &p3 },
+    };
+    const skcms_AlphaFormat alphas[] = {
+        skcms_AlphaFormat_Unpremul,
+        skcms_AlphaFormat_Opaque,
+        skcms_AlphaFormat_PremulAsEncoded,
+    };
+    // skcms_Transform() runs with the same backend, for the interpreter to compare against.
+    const bool jit = jit_available();
+    const skcms_Backend backend = jit ? skcms_Backend_HSW : skcms_GetBackend();
+    expect(skcms_SetBackend(backend));
+    for (int c = 0; c < (int)(sizeof(cases)/sizeof(*cases)); c++)
+    for (int k = 0; k < 3; k++) {
+        skcms_CompiledTransform* xform = skcms_TransformCreateWithBackend(
+                cases[c].srcFmt, alphas[k], cases[c].srcProfile,
+                cases[c].dstFmt, alphas[k], cases[c].dstProfile, backend);
+        expect(xform);
+        if (jit && !profiling()) {
+            expect(0 == strcmp(transform_path(xform), "JIT"));
+        }
+        memset(got, 0, sizeof(got));
+        expect(skcms_TransformRun(xform, cases[c].src, got, kN));
+        skcms_TransformDestroy(xform);
+
+        memset(want, 0, sizeof(want));
+        expect(skcms_Transform(cases[c].src, cases[c].srcFmt, alphas[k], cases[c].srcProfile,
+                               want,         cases[c].dstFmt, alphas[k], cases[c].dstProfile,
+                               kN));
+        expect(0 == memcmp(got, want, sizeof(want)));
+    }
+    expect(skcms_SetBackend(skcms_Backend_Auto));
+    free(ptr);
+}
+
+static void test_Backends(void) {
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile p3;
+    expect(load_file("profiles/mobile/Display_P3_parametric.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &p3));
+
+    expect(skcms_IsBackendAvailable(skcms_Backend_Auto));
+    expect(skcms_IsBackendAvailable(skcms_Backend_Baseline));
+    expect(skcms_GetBackend() != skcms_Backend_Auto);
+
+    enum { kN = 333 };
+    uint8_t src[kN*4];
+    float   want[kN*4], got[kN*4];
+    for (int i = 0; i < kN*4; i++) {
+        src[i] = (uint8_t)(i * 37);
+    }
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    skcms_CompiledTransform* baseline = skcms_TransformCreateWithBackend(
+            skcms_PixelFormat_RGBA_8888, upm, skcms_sRGB_profile(),
+            skcms_PixelFormat_RGBA_ffff, upm, &p3, skcms_Backend_Baseline);
+    expect(baseline);
+    expect(skcms_TransformGetBackend(baseline) == skcms_Backend_Baseline);
+    expect(skcms_TransformRun(baseline, src, want, kN));
+    skcms_TransformDestroy(baseline);
+
+    // Every backend we can run should agree closely with the baseline.
+    const skcms_Backend backends[] = {
+        skcms_Backend_SSE41,
+        skcms_Backend_HSW,
+        skcms_Backend_SKX,
+    };
+    for (int b = 0; b < 3; b++) {
+        skcms_CompiledTransform* xform = skcms_TransformCreateWithBackend(
+                skcms_PixelFormat_RGBA_8888, upm, skcms_sRGB_profile(),
+                skcms_PixelFormat_RGBA_ffff, upm, &p3, backends[b]);
+        expect(!xform == !skcms_IsBackendAvailable(backends[b]));
+        if (!xform) {
+            expect(!skcms_SetBackend(backends[b]));
+            continue;
+        }
+        expect(skcms_TransformGetBackend(xform) == backends[b]);
+        expect(skcms_TransformRun(xform, src, got, kN));
+        skcms_TransformDestroy(xform);
+        for (int i = 0; i < kN*4; i++) {
+            expect(fabsf_(got[i] - want[i]) < 1/1024.0f);
+        }
+
+        // Choosing a backend for the process affects transforms created afterwards.
+        expect(skcms_SetBackend(backends[b]));
+        expect(skcms_GetBackend() == backends[b]);
+        xform = skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, skcms_sRGB_profile(),
+                                      skcms_PixelFormat_RGBA_ffff, upm, &p3);
+        expect(xform);
+        expect(skcms_TransformGetBackend(xform) == backends[b]);
+        skcms_TransformDestroy(xform);
+    }
+
+    expect(skcms_SetBackend(skcms_Backend_Baseline));
+    expect(skcms_GetBackend() == skcms_Backend_Baseline);
+    expect(skcms_SetBackend(skcms_Backend_Auto));
+    expect(skcms_GetBackend() != skcms_Backend_Auto);
+    expect(!skcms_IsBackendAvailable((skcms_Backend)99));
+    free(ptr);
+}
+
+static void test_StageProfile(void) {
+    skcms_ResetStageProfile();
+
+    uint8_t src[64*4], dst[64*4];
+    for (int i = 0; i < 64*4; i++) {
+        src[i] = (uint8_t)i;
+    }
+    expect(skcms_Transform(src, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                           skcms_sRGB_profile(),
+                           dst, skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul,
+                           skcms_sRGB_profile(), 64));
+
+    // Only SKCMS_PROFILE builds keep track.  They should have seen our load and store.
+    skcms_StageProfile stages[64];
+    const int count = skcms_GetStageProfile(stages, 64);
+    bool saw_load = false;
+    for (int i = 0; i < count && i < 64; i++) {
+        expect(stages[i].calls > 0);
+        saw_load |= 0 == strcmp(stages[i].name, "load_8888");
+    }
+    expect(count == 0 || saw_load);
+
+    // Images big enough for byte lookups still run every op on every pixel when profiling,
+    // not just on the 256 that building lookup tables would sample, at most 16 per call.
+    skcms_ResetStageProfile();
+    enum { kW = 128, kH = 128 };
+    static uint8_t image[kW*kH*4];
+    skcms_ICCProfile linear = *skcms_sRGB_profile();
+    skcms_SetTransferFunction(&linear, skcms_Identity_TransferFunction());
+    expect(skcms_TransformImage(image, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                skcms_sRGB_profile(), kW*4,
+                                image, skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul,
+                                &linear, kW*4, kW, kH));
+    const int image_count = skcms_GetStageProfile(stages, 64);
+    for (int i = 0; i < image_count && i < 64; i++) {
+        if (0 == strcmp(stages[i].name, "load_8888")) {
+            expect(stages[i].calls >= kW*kH/16);
+        }
+    }
+
+    skcms_ResetStageProfile();
+    expect(skcms_GetStageProfile(stages, 64) == 0);
+}
+
+static void test_DescribeTransform(void) {
+    void*  ptr;
+    size_t len;
+    skcms_ICCProfile a2b;
+    expect(load_file("profiles/misc/MartiMaria_browsertest_A2B.icc", &ptr, &len));
+    expect(skcms_Parse(ptr, len, &a2b));
+
+    const skcms_AlphaFormat upm = skcms_AlphaFormat_Unpremul;
+    skcms_CompiledTransform* xform =
+        skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, &a2b,
+                              skcms_PixelFormat_RGBA_ffff, upm, skcms_sRGB_profile());
+    expect(xform);
+
+    skcms_TransformDescription desc;
+    skcms_DescribeTransform(xform, &desc);
+    expect(desc.backend == skcms_TransformGetBackend(xform));
+    expect(desc.path);
+    expect(desc.op_count >= 3);
+    expect(0 == strcmp(desc.ops[0], "load_8888"));
+    expect(0 == strcmp(desc.ops[desc.op_count-1], "store_ffff"));
+
+    bool saw_clut = false;
+    for (int i = 0; i < desc.op_count; i++) {
+        if (0 == strcmp(desc.ops[i], "clut_A2B")) {
+            saw_clut = true;
+            expect(strstr(desc.contexts[i], "3 -> 3 channels"));
+        }
+    }
+    expect(saw_clut);
+    skcms_TransformDestroy(xform);
+
+    // 8-bit sRGB to itself needs nothing between load and store.
+    xform = skcms_TransformCreate(skcms_PixelFormat_RGBA_8888, upm, skcms_sRGB_profile(),
+                                  skcms_PixelFormat_RGBA_8888, upm, skcms_sRGB_profile());
+    expect(xform);
+    skcms_DescribeTransform(xform, &desc);
+    expect(desc.op_count == 2);
+    expect(0 == strcmp(desc.contexts[0], ""));
+    skcms_TransformDestroy(xform);
+    free(ptr);
+}
+
 int main(int argc, char** argv) {
     bool regenTestData = false;
     for (int i = 1; i < argc; ++i) {
@@ -2427,7 +4028,27 @@ int main(int argc, char** argv) {
     test_CLUT_OutOfBoundsInput();
     test_B2A();
     test_CLUT_PageBoundary();
+    test_CLUT_Simplex();
     test_CLUT_PageBoundary2();
+    test_CompiledTransform();
+    test_TransformCache();
+    test_ProfileFingerprint();
+    test_TransformParallel();
+    test_TransformImage();
+    test_Planar();
+    test_YCbCr();
+    test_BakedLUT();
+    test_ByteLUTs();
+    test_Lowp();
+    test_SmallTables();
+    test_DecodedTables();
+    test_CLUTLayout();
+    test_Optimizer();
+    test_SpecializedKernels();
+    test_Jit();
+    test_Backends();
+    test_StageProfile();
+    test_DescribeTransform();
 
     test_Parse(regenTestData);
     test_sRGB_AllBytes();